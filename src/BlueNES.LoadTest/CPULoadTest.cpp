@@ -81,7 +81,8 @@ void CPULoadTest::runInstructionThroughputTest(size_t cycles) {
     size_t cyclesExecuted = 0;
     while (cyclesExecuted < cycles) {
         flushCacheLine(&nes.cart_->mapper->m_prgRomData[0]);
-        cyclesExecuted += cpu->Clock();
+        cpu->cpu_tick();
+        cyclesExecuted++;
         sink = cyclesExecuted; // Prevent optimization
     }
 
@@ -111,7 +112,8 @@ void CPULoadTest::runFrameBasedTest(size_t frames) {
         size_t frameCycles = 0;
         while (frameCycles < CYCLES_PER_FRAME) {
             flushCacheLine(&nes.cart_->mapper->m_prgRomData[0]);
-            frameCycles += cpu->Clock();
+            cpu->cpu_tick();
+            frameCycles++;
         }
         sink = frameCycles;
     }
@@ -143,7 +145,7 @@ void CPULoadTest::runInterruptStressTest(size_t interrupts) {
         // Execute some instructions
         for (int j = 0; j < 10; ++j) {
             flushCacheLine(&nes.cart_->mapper->m_prgRomData[0]);
-            cpu->Clock();
+            cpu->cpu_tick();
         }
 
         // Trigger IRQ
@@ -152,7 +154,7 @@ void CPULoadTest::runInterruptStressTest(size_t interrupts) {
         // Execute interrupt handler
         for (int j = 0; j < 5; ++j) {
             flushCacheLine(&nes.cart_->mapper->m_prgRomData[0]);
-            cpu->Clock();
+            cpu->cpu_tick();
         }
 
         sink = i;
@@ -191,7 +193,7 @@ void CPULoadTest::runMemoryIntensiveTest(size_t iterations) {
 
     for (size_t i = 0; i < iterations; ++i) {
         flushCacheLine(&nes.cart_->mapper->m_prgRomData[0]);
-		cpu->Clock();
+		cpu->cpu_tick();
         sink = i;
     }
 
@@ -233,7 +235,7 @@ void CPULoadTest::runBranchHeavyTest(size_t iterations) {
 
     for (size_t i = 0; i < iterations; ++i) {
         flushCacheLine(&nes.cart_->mapper->m_prgRomData[0]);
-		cpu->Clock();
+		cpu->cpu_tick();
         sink = i;
     }
 
@@ -257,7 +259,7 @@ void CPULoadTest::runMultiInstanceTest(size_t iterations, size_t instanceCount)
             // This is a simplified version
             for (size_t i = 0; i < iterations; ++i) {
                 flushCacheLine(&nes.cart_->mapper->m_prgRomData[0]);
-                cpu->Clock();
+                cpu->cpu_tick();
                 completedOps.fetch_add(1, std::memory_order_relaxed);
             }
         });
@@ -286,7 +288,7 @@ void CPULoadTest::runSustainedLoadTest(size_t durationSeconds) {
     size_t cyclesExecuted = 0;
     while (std::chrono::high_resolution_clock::now() < endTime) {
         flushCacheLine(&nes.cart_->mapper->m_prgRomData[0]);
-        cpu->Clock();
+        cpu->cpu_tick();
         cyclesExecuted++;
         sink = cyclesExecuted;
     }
@@ -297,6 +299,32 @@ void CPULoadTest::runSustainedLoadTest(size_t durationSeconds) {
     printResults("Sustained Load", cyclesExecuted, duration.count());
 }
 
+// Test 8: Same program on both dispatch engines
+void CPULoadTest::runDispatchComparisonTest(size_t cycles) {
+    std::cout << "\n=== Dispatch Comparison Test ===" << std::endl;
+
+    long long durations[2] = {};
+    for (int flat = 0; flat < 2; ++flat) {
+        loadProgram();
+        cpu->Reset();
+        cpu->SetFlatDispatch(flat == 1);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < cycles; ++i) {
+            cpu->cpu_tick();
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        durations[flat] = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        sink = cpu->GetCycleCount();
+
+        printResults(flat ? "Flat Dispatch" : "Reference Dispatch", cycles, durations[flat]);
+    }
+    cpu->SetFlatDispatch(false);
+
+    std::cout << "  Speedup: " << std::fixed << std::setprecision(2)
+        << (double)durations[0] / durations[1] << "x" << std::endl;
+}
+
 void CPULoadTest::printResults(const std::string& testName, size_t operations, long long microseconds) {
     double opsPerSecond = (operations * 1000000.0) / microseconds;
     double nsPerOp = (microseconds * 1000.0) / operations;
@@ -18,7 +18,7 @@
 class CPULoadTest {
 private:
     Nes& nes;
-    Processor_6502* cpu;
+    CPU* cpu;
     Cartridge* cart;
     std::mt19937 rng;
     std::vector<uint8_t> testProgram;
@@ -54,6 +54,9 @@ public:
     // Test 7: Sustained load test (thermal/stability)
     void runSustainedLoadTest(size_t durationSeconds);
 
+    // Test 8: Reference dispatch vs the flattened (opcode, step) table
+    void runDispatchComparisonTest(size_t cycles);
+
 private:
     void printResults(const std::string& testName, size_t operations, long long microseconds);
 
@@ -50,6 +50,7 @@ int cpu() {
     test->runMemoryIntensiveTest(100000);           // 100K memory ops
     test->runBranchHeavyTest(100000);               // 100K branch instructions
     test->runSustainedLoadTest(5);                  // 5 second sustained load
+    test->runDispatchComparisonTest(10000000);      // 10M cycles per engine
 
     std::cout << "\n=== CPU Load Test Complete ===" << std::endl;
 
@@ -1,4 +1,11 @@
 #include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <memory>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
 #include "pch.h"
 #include "CppUnitTest.h"
 #include "CPU.h"
@@ -9,6 +16,17 @@
 #include "SharedContext.h"
 #include "Mapper.h"
 #include "NROM.h"
+#include "MMC3.h"
+#include "PPU.h"
+#include "RendererLoopy.h"
+#include "RendererScanline.h"
+#include "APU.h"
+#include "BlipBuffer.h"
+#include "DebuggerContext.h"
+#include "Serializer.h"
+#include "RewindBuffer.h"
+#include "RunAhead.h"
+#include "SaveStateWriter.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -29,6 +47,19 @@ namespace BlueNESTest
 				cpu->cpu_tick();
 			}
 		}
+		// Sets up a standalone Nes with a 32KB program (NROM unless a mapper is given), for tests that need the whole machine running
+		void LoadProgram(Nes& target, uint8_t* rom, std::vector<uint32_t>& frame, MapperBase* mapper = nullptr) {
+			target.cart_->mapper = mapper ? mapper : new NROM(target.cart_);
+			target.cart_->mapper->register_memory(*target.bus_);
+			target.cart_->mapper->SetPRGRom(rom, 0x8000);
+			uint8_t chr[0x2000] = {};
+			target.cart_->mapper->SetCHRRom(chr, sizeof(chr));
+			target.cart_->mapper->_vram.resize(0x800);
+			target.cart_->mapper->RecomputeMappings();
+			target.ppu_->setBuffer(frame.data());
+			target.cpu_->PowerCycle();
+			target.cpu_->SetPC(0x8000);
+		}
 
 	public:
 		TEST_METHOD_INITIALIZE(TestSetup)
@@ -2311,5 +2342,1600 @@ namespace BlueNESTest
 			Assert::AreEqual((uint16_t)0x8002, cpu->GetPC());
 			Assert::IsTrue(cpu->GetCycleCount() == 3);
 		}
+
+		// Bus page table
+		TEST_METHOD(TestBusPageTableRAMMirror)
+		{
+			Assert::IsNotNull(bus->readPages[0x00]);
+			bus->write(0x0012, 0x5A);
+			Assert::AreEqual((uint8_t)0x5A, bus->read(0x0812));
+			Assert::AreEqual((uint8_t)0x5A, bus->read(0x1812));
+			Assert::AreEqual((uint8_t)0x5A, bus->ramMapper.cpuRAM[0x12]);
+		}
+		TEST_METHOD(TestBusPageTablePRG)
+		{
+			bus->write(0x6010, 0xA5);
+			Assert::AreEqual((uint8_t)0xA5, cart->mapper->m_prgRamData[0x10]);
+			Assert::AreEqual((uint8_t)0xA5, bus->read(0x6010));
+			uint8_t rom[] = { 0x11, 0x22 };
+			cart->mapper->SetPRGRom(rom, sizeof(rom));
+			Assert::AreEqual((uint8_t)0x22, bus->read(0x8001));
+			// PRG-ROM writes are mapper registers, never direct
+			Assert::IsNull(bus->writePages[0x80]);
+			// I/O pages stay on the memory map
+			Assert::IsNull(bus->readPages[0x20]);
+			Assert::IsNull(bus->readPages[0x40]);
+		}
+
+		// Flattened dispatch has to match the reference engine cycle for cycle
+		TEST_METHOD(TestFlatDispatchMatchesReference)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xA9, 0x00,       // 8000 LDA #$00
+				0x85, 0xF0,       // 8002 STA $F0
+				0x85, 0xF1,       // 8004 STA $F1
+				0xA2, 0x08,       // 8006 LDX #$08
+				0xA9, 0x81,       // 8008 LDA #$81
+				0x1E, 0x00, 0x03, // 800A ASL $0300,X
+				0x95, 0x10,       // 800D STA $10,X
+				0x75, 0x10,       // 800F ADC $10,X
+				0x20, 0x20, 0x80, // 8011 JSR $8020
+				0xCA,             // 8014 DEX
+				0xD0, 0xF1,       // 8015 BNE $8008
+				0x4C, 0x00, 0x80, // 8017 JMP $8000
+			};
+			memcpy(rom, prog, sizeof(prog));
+			rom[0x20] = 0xB1; // 8020 LDA ($F0),Y
+			rom[0x21] = 0xF0;
+			rom[0x22] = 0x60; // 8022 RTS
+			cart->mapper->SetPRGRom(rom, sizeof(rom));
+
+			const int ticks = 2000;
+			std::vector<uint64_t> trace;
+			for (int pass = 0; pass < 2; pass++) {
+				cpu->SetFlatDispatch(pass == 1);
+				bus->ramMapper.cpuRAM.fill(0);
+				cpu->PowerCycle();
+				cpu->SetPC(0x8000);
+				for (int i = 0; i < ticks; i++) {
+					cpu->cpu_tick();
+					uint64_t state = ((uint64_t)cpu->GetPC() << 40) | ((uint64_t)cpu->GetA() << 32) |
+						((uint64_t)cpu->GetX() << 24) | ((uint64_t)cpu->GetStatus() << 16) |
+						((uint64_t)cpu->GetSP() << 8) | (uint64_t)cpu->cycle_state;
+					if (pass == 0) {
+						trace.push_back(state);
+					}
+					else {
+						Assert::AreEqual(trace[i], state);
+					}
+				}
+			}
+			cpu->SetFlatDispatch(false);
+		}
+
+		// Instruction-stepped mode has to see $2002 at the same cycle as the lockstep clock
+		TEST_METHOD(TestInstructionSteppedVBlankPoll)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xAD, 0x02, 0x20, // 8000 LDA $2002
+				0x10, 0xFB,       // 8003 BPL $8000
+				0x4C, 0x05, 0x80, // 8005 JMP $8005
+			};
+			memcpy(rom, prog, sizeof(prog));
+
+			uint64_t exitCycle[2] = {};
+			for (int stepped = 0; stepped < 2; stepped++) {
+				SharedContext runCtx;
+				Nes runNes(runCtx);
+				std::vector<uint32_t> frame(256 * 240);
+				LoadProgram(runNes, rom, frame);
+				runNes.SetInstructionStepped(stepped == 1);
+				while (runNes.cpu_->GetCycleCount() < 100000) {
+					if (stepped) {
+						runNes.stepInstruction();
+					}
+					else {
+						runNes.clock();
+					}
+					if (runNes.cpu_->inst_complete && runNes.cpu_->GetPC() == 0x8005) {
+						break;
+					}
+				}
+				exitCycle[stepped] = runNes.cpu_->GetCycleCount();
+				Assert::IsTrue(exitCycle[stepped] < 100000);
+			}
+			Assert::AreEqual(exitCycle[0], exitCycle[1]);
+		}
+
+		// Skipping a JMP * loop must land the NMIs on the same cycles as running it
+		TEST_METHOD(TestIdleLoopSkipMatchesFullRun)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xA9, 0x80,       // 8000 LDA #$80
+				0x8D, 0x00, 0x20, // 8002 STA $2000
+				0x4C, 0x05, 0x80, // 8005 JMP $8005
+			};
+			memcpy(rom, prog, sizeof(prog));
+			rom[0x1000] = 0xE6; // 9000 INC $10
+			rom[0x1001] = 0x10;
+			rom[0x1002] = 0x40; // 9002 RTI
+			rom[0xFFFA - 0x8000] = 0x00;
+			rom[0xFFFB - 0x8000] = 0x90;
+
+			uint64_t nmiCycle[2][3] = {};
+			uint64_t skipped[2] = {};
+			for (int skip = 0; skip < 2; skip++) {
+				SharedContext runCtx;
+				Nes runNes(runCtx);
+				std::vector<uint32_t> frame(256 * 240);
+				LoadProgram(runNes, rom, frame);
+				runNes.bus_->ramMapper.cpuRAM[0x10] = 0;
+				runNes.idleSkip = skip == 1;
+				int seen = 0;
+				while (seen < 3 && runNes.cpu_->GetCycleCount() < 200000) {
+					runNes.clock();
+					if (runNes.bus_->ramMapper.cpuRAM[0x10] != seen) {
+						nmiCycle[skip][seen++] = runNes.cpu_->GetCycleCount();
+					}
+				}
+				Assert::AreEqual(3, seen);
+				skipped[skip] = runNes.idleCyclesSkipped;
+			}
+			Assert::AreEqual((uint64_t)0, skipped[0]);
+			Assert::IsTrue(skipped[1] > 0);
+			for (int i = 0; i < 3; i++) {
+				Assert::AreEqual(nmiCycle[0][i], nmiCycle[1][i]);
+			}
+		}
+
+		// Polling PPUSTATUS with rendering on: VBlank and sprite 0 hit have to be seen on the same cycle
+		TEST_METHOD(TestIdleLoopSkipPollingStatus)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xA9, 0x18,       // 8000 LDA #$18
+				0x8D, 0x01, 0x20, // 8002 STA $2001
+				0x2C, 0x02, 0x20, // 8005 BIT $2002  wait for VBlank
+				0x10, 0xFB,       // 8008 BPL $8005
+				0xE6, 0x10,       // 800A INC $10
+				0x2C, 0x02, 0x20, // 800C BIT $2002  wait for sprite 0 hit to clear
+				0x70, 0xFB,       // 800F BVS $800C
+				0x2C, 0x02, 0x20, // 8011 BIT $2002  then for the next hit
+				0x50, 0xFB,       // 8014 BVC $8011
+				0xE6, 0x11,       // 8016 INC $11
+				0x4C, 0x05, 0x80, // 8018 JMP $8005
+			};
+			memcpy(rom, prog, sizeof(prog));
+
+			std::vector<uint64_t> changes[2];
+			uint64_t skipped[2] = {};
+			for (int skip = 0; skip < 2; skip++) {
+				SharedContext runCtx;
+				Nes runNes(runCtx);
+				std::vector<uint32_t> frame(256 * 240);
+				LoadProgram(runNes, rom, frame);
+				runNes.ppu_->reset();
+				runNes.cart_->mapper->SetMirrorMode(MapperBase::VERTICAL);
+				for (auto& b : runNes.cart_->mapper->m_chrData) b = 0xFF;
+				runNes.cart_->mapper->RecomputeMappings();
+				const uint8_t sprite0[] = { 100, 0, 0, 100 };
+				memcpy(runNes.ppu_->oam.data(), sprite0, sizeof(sprite0));
+				runNes.bus_->ramMapper.cpuRAM[0x10] = 0;
+				runNes.bus_->ramMapper.cpuRAM[0x11] = 0;
+				runNes.idleSkip = skip == 1;
+				uint8_t last[2] = {};
+				while (runNes.cpu_->GetCycleCount() < 150000) {
+					runNes.clock();
+					for (int i = 0; i < 2; i++) {
+						if (runNes.bus_->ramMapper.cpuRAM[0x10 + i] != last[i]) {
+							last[i] = runNes.bus_->ramMapper.cpuRAM[0x10 + i];
+							changes[skip].push_back(runNes.cpu_->GetCycleCount() * 2 + i);
+						}
+					}
+				}
+				skipped[skip] = runNes.idleCyclesSkipped;
+			}
+			Assert::IsTrue(changes[0].size() >= 8);
+			Assert::IsTrue(skipped[1] > 0);
+			Assert::IsTrue(changes[0] == changes[1]);
+		}
+
+		// APU::step(n) has to end up exactly where n calls to step() do
+		TEST_METHOD(TestAPUSpanMatchesPerCycle)
+		{
+			APU reference;
+			APU spans;
+			int refFetches = 0;
+			int spanFetches = 0;
+			reference.set_dmc_read_callback([&](uint16_t address) -> uint8_t { refFetches++; return (uint8_t)(address * 37); });
+			spans.set_dmc_read_callback([&](uint16_t address) -> uint8_t { spanFetches++; return (uint8_t)(address * 37); });
+			const uint16_t regs[][2] = {
+				{ 0x4015, 0x1F },
+				{ 0x4000, 0x9F }, { 0x4001, 0x00 }, { 0x4002, 0xFD }, { 0x4003, 0x08 },
+				{ 0x4004, 0x4A }, { 0x4005, 0xA3 }, { 0x4006, 0x40 }, { 0x4007, 0x11 },
+				{ 0x4008, 0x7F }, { 0x400A, 0x80 }, { 0x400B, 0x09 },
+				{ 0x400C, 0x05 }, { 0x400E, 0x83 }, { 0x400F, 0x18 },
+				{ 0x4010, 0x8F }, { 0x4012, 0x00 }, { 0x4013, 0x01 },
+				{ 0x4017, 0x00 },
+			};
+			for (auto& reg : regs) {
+				reference.write_register(reg[0], (uint8_t)reg[1]);
+				spans.write_register(reg[0], (uint8_t)reg[1]);
+			}
+			// Spans of all sorts of lengths, across several frame sequencer periods
+			uint32_t chunk = 1;
+			for (int i = 0; i < 2000; i++) {
+				chunk = (chunk * 1103515245 + 12345) % 397 + 1;
+				for (uint32_t c = 0; c < chunk; c++) {
+					reference.step();
+				}
+				spans.step(chunk);
+				Assert::AreEqual(reference.get_output(), spans.get_output());
+				Assert::AreEqual(reference.peek_register(0x4015), spans.peek_register(0x4015));
+				Assert::AreEqual(refFetches, spanFetches);
+				if (i == 1000) {
+					// Switch to 5-step mode halfway
+					reference.write_register(0x4017, 0x80);
+					spans.write_register(0x4017, 0x80);
+				}
+			}
+		}
+
+		TEST_METHOD(TestBlipBufferStepResponse)
+		{
+			BlipBuffer blip(4096);
+			blip.SetRates(CPU_FREQ, 44100);
+			// Step up a quarter of the way into the frame, back down at three quarters
+			blip.AddDelta(7445, 0.5f);
+			blip.AddDelta(22335, -0.5f);
+			blip.EndFrame(29780);
+			int count = blip.SamplesAvailable();
+			Assert::IsTrue(count >= 733 && count <= 734);
+			std::vector<float> samples(count);
+			Assert::AreEqual(count, blip.ReadSamples(samples.data(), count));
+			// Settled levels away from the edges, ringing only right around them
+			Assert::AreEqual(0.0f, samples[100], 0.0001f);
+			Assert::AreEqual(0.5f, samples[367], 0.0001f);
+			Assert::AreEqual(0.0f, samples[700], 0.0001f);
+			float peak = 0.0f;
+			for (float s : samples) {
+				peak = (std::max)(peak, s);
+			}
+			Assert::IsTrue(peak < 0.56f);
+		}
+
+		TEST_METHOD(TestAPUBandLimitedMatchesPerCycle)
+		{
+			// Stopping the spans at every output change must not change the emulation
+			APU reference;
+			APU banded;
+			BlipBuffer blip(8192);
+			blip.SetRates(CPU_FREQ, 44100);
+			banded.blip = &blip;
+			const uint16_t regs[][2] = {
+				{ 0x4015, 0x0F },
+				{ 0x4000, 0xBF }, { 0x4002, 0x80 }, { 0x4003, 0x01 },
+				{ 0x4004, 0x4A }, { 0x4005, 0xA3 }, { 0x4006, 0x40 }, { 0x4007, 0x11 },
+				{ 0x4008, 0x7F }, { 0x400A, 0x80 }, { 0x400B, 0x09 },
+				{ 0x400C, 0x05 }, { 0x400E, 0x03 }, { 0x400F, 0x18 },
+			};
+			for (auto& reg : regs) {
+				reference.write_register(reg[0], (uint8_t)reg[1]);
+				banded.write_register(reg[0], (uint8_t)reg[1]);
+			}
+			for (int frame = 0; frame < 4; frame++) {
+				for (int c = 0; c < 29780; c++) {
+					reference.step();
+				}
+				banded.step(29780);
+				Assert::AreEqual(reference.get_output(), banded.get_output());
+				Assert::AreEqual(29780u, banded.blip_time);
+				blip.EndFrame(banded.blip_time);
+				banded.blip_time = 0;
+				std::vector<float> samples(blip.SamplesAvailable());
+				blip.ReadSamples(samples.data(), (int)samples.size());
+				// A 50% pulse at full volume has to swing
+				float low = *std::min_element(samples.begin(), samples.end());
+				float high = *std::max_element(samples.begin(), samples.end());
+				Assert::IsTrue(high - low > 0.1f);
+			}
+		}
+
+		TEST_METHOD(TestMixerTablesMatchFormula)
+		{
+			// Every pulse pair against every triangle/noise/DMC combination
+			std::vector<uint8_t> p1, p2, tr, no, dm;
+			for (int pulse = 0; pulse < 16 * 16; pulse++) {
+				for (int tnd = 0; tnd < 16 * 16 * 128; tnd += 61) {
+					p1.push_back((uint8_t)(pulse >> 4));
+					p2.push_back((uint8_t)(pulse & 15));
+					tr.push_back((uint8_t)(tnd >> 11));
+					no.push_back((uint8_t)((tnd >> 7) & 15));
+					dm.push_back((uint8_t)(tnd & 127));
+				}
+			}
+			std::vector<float> mixed(p1.size());
+			APU::mix_batch(p1.data(), p2.data(), tr.data(), no.data(), dm.data(), mixed.data(), mixed.size());
+			// The 3t+2n+d index can't match the weighted sum exactly. Worst case is DMC alone around 117,
+			// ~0.0168 out of ~1.4 full scale. Pulse is exact.
+			for (size_t i = 0; i < mixed.size(); i++) {
+				Assert::AreEqual(APU::mix_reference(p1[i], p2[i], tr[i], no[i], dm[i]), mixed[i], 0.017f);
+			}
+		}
+
+		TEST_METHOD(TestSkipOutputKeepsSprite0Timing)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xA9, 0x00,       // 8000 LDA #$00
+				0x8D, 0x03, 0x20, // 8002 STA $2003
+				0xA9, 0x31,       // 8005 LDA #$31  sprite 0 at y=49
+				0x8D, 0x04, 0x20, // 8007 STA $2004
+				0xA9, 0x00,       // 800A LDA #$00  tile 0
+				0x8D, 0x04, 0x20, // 800C STA $2004
+				0x8D, 0x04, 0x20, // 800F STA $2004 attributes
+				0xA9, 0x64,       // 8012 LDA #$64  x=100
+				0x8D, 0x04, 0x20, // 8014 STA $2004
+				0xA9, 0x1E,       // 8017 LDA #$1E
+				0x8D, 0x01, 0x20, // 8019 STA $2001
+				0x2C, 0x02, 0x20, // 801C BIT $2002  wait for the hit
+				0x50, 0xFB,       // 801F BVC $801C
+				0xE6, 0x10,       // 8021 INC $10
+				0x2C, 0x02, 0x20, // 8023 BIT $2002  wait for pre-render to clear it
+				0x70, 0xFB,       // 8026 BVS $8023
+				0x4C, 0x1C, 0x80, // 8028 JMP $801C
+			};
+			memcpy(rom, prog, sizeof(prog));
+
+			const uint32_t sentinel = 0x12345678;
+			uint64_t hitCycle[2][4] = {};
+			bool untouched[2] = {};
+			for (int skip = 0; skip < 2; skip++) {
+				SharedContext runCtx;
+				Nes runNes(runCtx);
+				std::vector<uint32_t> frame(256 * 240);
+				LoadProgram(runNes, rom, frame);
+				runNes.ppu_->reset();
+				// Every tile is solid, so the background and sprite 0 are opaque everywhere
+				auto& chr = runNes.cart_->mapper->m_chrData;
+				for (size_t tile = 0; tile < chr.size(); tile += 16) {
+					std::fill(chr.begin() + tile, chr.begin() + tile + 8, 0xFF);
+				}
+				runNes.cart_->mapper->RecomputeMappings();
+				runNes.bus_->ramMapper.cpuRAM[0x10] = 0;
+				runNes.ppu_->SetSkipOutput(skip == 1);
+				int seen = 0;
+				bool firstFrame = true;
+				while (seen < 4 && runNes.cpu_->GetCycleCount() < 200000) {
+					runNes.clock();
+					if (firstFrame && runNes.frameReady()) {
+						// The skip only starts with the next frame
+						firstFrame = false;
+						std::fill(frame.begin(), frame.end(), sentinel);
+					}
+					if (runNes.bus_->ramMapper.cpuRAM[0x10] != seen) {
+						hitCycle[skip][seen++] = runNes.cpu_->GetCycleCount();
+					}
+				}
+				Assert::AreEqual(4, seen);
+				untouched[skip] = std::all_of(frame.begin(), frame.end(), [&](uint32_t p) { return p == sentinel; });
+			}
+			Assert::IsFalse(untouched[0]);
+			Assert::IsTrue(untouched[1]);
+			for (int i = 0; i < 4; i++) {
+				Assert::AreEqual(hitCycle[0][i], hitCycle[1][i]);
+			}
+		}
+
+		TEST_METHOD(TestTileSpansMatchPerDot)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xA9, 0x30,       // 8000 LDA #$30  8x16 sprites, background at $1000
+				0x8D, 0x00, 0x20, // 8002 STA $2000
+				0xA9, 0x05,       // 8005 LDA #$05  fine X 5
+				0x8D, 0x05, 0x20, // 8007 STA $2005
+				0xA9, 0x00,       // 800A LDA #$00
+				0x8D, 0x05, 0x20, // 800C STA $2005
+				0xE8,             // 800F INX
+				0x8A,             // 8010 TXA
+				0x29, 0xE7,       // 8011 AND #$E7  cycle through emphasis, grayscale and left clipping
+				0x09, 0x18,       // 8013 ORA #$18
+				0x8D, 0x01, 0x20, // 8015 STA $2001
+				0x29, 0x0F,       // 8018 AND #$0F
+				0xA8,             // 801A TAY
+				0x88,             // 801B DEY       wait a varying number of dots
+				0x10, 0xFD,       // 801C BPL $801B
+				0x4C, 0x0F, 0x80, // 801E JMP $800F
+			};
+			memcpy(rom, prog, sizeof(prog));
+
+			std::vector<uint32_t> frames[2];
+			uint8_t status[2] = {};
+			for (int spans = 0; spans < 2; spans++) {
+				SharedContext runCtx;
+				Nes runNes(runCtx);
+				frames[spans].resize(256 * 240);
+				LoadProgram(runNes, rom, frames[spans]);
+				runNes.ppu_->reset();
+				runNes.ppu_->renderer->m_tileSpans = spans == 1;
+				uint32_t seed = 12345;
+				auto next = [&]() { seed = seed * 1103515245 + 12345; return (uint8_t)(seed >> 16); };
+				for (auto& b : runNes.cart_->mapper->m_chrData) b = next();
+				for (auto& b : runNes.cart_->mapper->_vram) b = next();
+				for (auto& b : runNes.ppu_->paletteTable) b = next() & 0x3F;
+				for (auto& b : runNes.ppu_->oam) b = next();
+				runNes.cart_->mapper->SetMirrorMode(MapperBase::VERTICAL);
+				runNes.cart_->mapper->RecomputeMappings();
+				while (runNes.cpu_->GetCycleCount() < 100000) {
+					runNes.clock();
+				}
+				runNes.ppu_->CatchUp();
+				status[spans] = runNes.ppu_->GetPPUStatus();
+			}
+			Assert::AreEqual(status[0], status[1]);
+			Assert::IsTrue(frames[0] == frames[1]);
+		}
+
+		TEST_METHOD(TestColorTableEmphasisRows)
+		{
+			PPU& ppu = *nes->ppu_;
+			// Built-in palette: row 0 is the palette itself, emphasis rows darken the other channels
+			Assert::AreEqual(m_nesPalette[0x21], ppu.GetColorRow(0x00)[0x21]);
+			uint32_t red = ppu.GetColorRow(PPUMASK_EMPHASIZERED)[0x30];
+			Assert::AreEqual((uint32_t)0xFF, (red >> 16) & 0xFF);
+			Assert::AreEqual((uint32_t)(uint8_t)(0xFE * 0.75f), (red >> 8) & 0xFF);
+
+			// A 512 color palette is used as is, one row per emphasis combination
+			std::vector<uint8_t> rgb(512 * 3);
+			for (size_t i = 0; i < 512; i++) {
+				rgb[i * 3] = (uint8_t)(i >> 1);
+				rgb[i * 3 + 1] = (uint8_t)i;
+				rgb[i * 3 + 2] = (uint8_t)(i * 3);
+			}
+			ppu.SetPalette(rgb.data(), 512);
+			for (int emphasis = 0; emphasis < 8; emphasis++) {
+				uint32_t color = ppu.GetColorRow((uint8_t)(emphasis << 5))[0x15];
+				size_t i = emphasis * 64 + 0x15;
+				Assert::AreEqual(0xFF000000u | (rgb[i * 3] << 16) | (rgb[i * 3 + 1] << 8) | rgb[i * 3 + 2], color);
+			}
+			ppu.ResetPalette();
+			Assert::AreEqual(m_nesPalette[0x15], ppu.GetColorRow(0x00)[0x15]);
+		}
+
+		TEST_METHOD(TestIndexBufferMatchesARGB)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xE8,             // 8000 INX
+				0x8A,             // 8001 TXA
+				0x29, 0xFF,       // 8002 AND #$FF  cycle through emphasis, grayscale, clipping and rendering off
+				0x8D, 0x01, 0x20, // 8004 STA $2001
+				0x29, 0x0F,       // 8007 AND #$0F
+				0xA8,             // 8009 TAY
+				0x88,             // 800A DEY
+				0x10, 0xFD,       // 800B BPL $800A
+				0x4C, 0x00, 0x80, // 800D JMP $8000
+			};
+			memcpy(rom, prog, sizeof(prog));
+
+			std::vector<uint32_t> frames[2];
+			std::vector<uint16_t> indices(256 * 240, 0xFFFF);
+			for (int indexed = 0; indexed < 2; indexed++) {
+				SharedContext runCtx;
+				Nes runNes(runCtx);
+				frames[indexed].assign(256 * 240, 0);
+				LoadProgram(runNes, rom, frames[indexed]);
+				runNes.ppu_->reset();
+				if (indexed) runNes.ppu_->SetIndexBuffer(indices.data());
+				uint32_t seed = 777;
+				auto next = [&]() { seed = seed * 1103515245 + 12345; return (uint8_t)(seed >> 16); };
+				for (auto& b : runNes.cart_->mapper->m_chrData) b = next();
+				for (auto& b : runNes.cart_->mapper->_vram) b = next();
+				for (auto& b : runNes.ppu_->paletteTable) b = next() & 0x3F;
+				for (auto& b : runNes.ppu_->oam) b = next();
+				runNes.cart_->mapper->SetMirrorMode(MapperBase::VERTICAL);
+				runNes.cart_->mapper->RecomputeMappings();
+				while (runNes.cpu_->GetCycleCount() < 100000) {
+					runNes.clock();
+				}
+				runNes.ppu_->CatchUp();
+				if (indexed) {
+					// Nothing went to the ARGB buffer, and every index is in the table
+					Assert::IsTrue(std::all_of(frames[1].begin(), frames[1].end(), [](uint32_t c) { return c == 0; }));
+					Assert::IsTrue(std::all_of(indices.begin(), indices.end(), [](uint16_t i) { return i < 512; }));
+					runNes.ppu_->ConvertIndices(indices.data(), frames[1].data(), indices.size());
+				}
+			}
+			Assert::IsTrue(frames[0] == frames[1]);
+		}
+
+		TEST_METHOD(TestSpriteEvaluationFollowsOAMWrites)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0x2C, 0x02, 0x20, // 8000 BIT $2002  wait for VBlank
+				0x10, 0xFB,       // 8003 BPL $8000
+				0xA2, 0x00,       // 8005 LDX #$00
+				0x8E, 0x03, 0x20, // 8007 STX $2003
+				0xBD, 0x00, 0x81, // 800A LDA $8100,X  copy 11 sprites into OAM
+				0x8D, 0x04, 0x20, // 800D STA $2004
+				0xE8,             // 8010 INX
+				0xE0, 0x2C,       // 8011 CPX #$2C
+				0xD0, 0xF5,       // 8013 BNE $800A
+				0xA9, 0x14,       // 8015 LDA #$14  sprites on, background off
+				0x8D, 0x01, 0x20, // 8017 STA $2001
+				0x2C, 0x02, 0x20, // 801A BIT $2002  next VBlank
+				0x10, 0xFB,       // 801D BPL $801A
+				0xA9, 0x03,       // 801F LDA #$03
+				0x8D, 0x03, 0x20, // 8021 STA $2003
+				0xA9, 0xC8,       // 8024 LDA #$C8  move sprite 0 to X 200
+				0x8D, 0x04, 0x20, // 8026 STA $2004
+				0x4C, 0x29, 0x80, // 8029 JMP $8029
+			};
+			memcpy(rom, prog, sizeof(prog));
+			// Once moved, sprite 0 (tile 1, color 1) overlaps sprite 1 (tile 0, color 3) and wins.
+			// Sprites 2-10 share a line, only the first 8 are drawn and overflow is set.
+			const uint8_t sprites[] = { 99, 1, 0, 100, 99, 0, 0, 196 };
+			memcpy(rom + 0x100, sprites, sizeof(sprites));
+			for (int i = 0; i < 9; i++) {
+				const uint8_t sprite[] = { 20, 0, 0, (uint8_t)(i * 16) };
+				memcpy(rom + 0x108 + i * 4, sprite, sizeof(sprite));
+			}
+
+			SharedContext runCtx;
+			Nes runNes(runCtx);
+			std::vector<uint32_t> frame(256 * 240);
+			LoadProgram(runNes, rom, frame);
+			runNes.ppu_->reset();
+			runNes.cart_->mapper->SetMirrorMode(MapperBase::VERTICAL);
+			auto& chr = runNes.cart_->mapper->m_chrData;
+			for (int row = 0; row < 8; row++) {
+				chr[row] = 0xFF;      // Tile 0: color 3
+				chr[row + 8] = 0xFF;
+				chr[16 + row] = 0xFF; // Tile 1: color 1
+			}
+			runNes.cart_->mapper->RecomputeMappings();
+			for (uint8_t i = 0; i < 32; i++) {
+				runNes.ppu_->paletteTable[i] = i;
+			}
+			// Up to part way into the frame after sprite 0 moved
+			while (runNes.cpu_->GetCycleCount() < 80000) {
+				runNes.clock();
+			}
+			runNes.ppu_->CatchUp();
+
+			const uint32_t* colors = runNes.ppu_->colorTable.data();
+			auto at = [&](int x, int y) { return frame[y * 256 + x]; };
+			Assert::IsTrue((runNes.ppu_->GetPPUStatus() & PPUSTATUS_SPRITE_OVERFLOW) != 0);
+			for (int y = 21; y < 29; y++) {
+				for (int i = 0; i < 8; i++) {
+					Assert::AreEqual(colors[0x13], at(i * 16 + 3, y));
+				}
+				Assert::AreEqual(colors[0x00], at(8 * 16 + 3, y));
+			}
+			for (int y = 100; y < 108; y++) {
+				Assert::AreEqual(colors[0x00], at(100, y));
+				Assert::AreEqual(colors[0x00], at(107, y));
+				Assert::AreEqual(colors[0x13], at(196, y));
+				Assert::AreEqual(colors[0x13], at(199, y));
+				Assert::AreEqual(colors[0x11], at(200, y));
+				Assert::AreEqual(colors[0x11], at(207, y));
+				Assert::AreEqual(colors[0x00], at(208, y));
+			}
+			Assert::AreEqual(colors[0x00], at(200, 99));
+			Assert::AreEqual(colors[0x00], at(200, 108));
+		}
+
+		TEST_METHOD(TestA12BatchingMatchesEveryFetch)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xA9, 0x00,       // 8000 LDA #ctrl
+				0x8D, 0x00, 0x20, // 8002 STA $2000
+				0xA9, 0x1E,       // 8005 LDA #$1E
+				0x8D, 0x01, 0x20, // 8007 STA $2001
+				0xA9, 0x14,       // 800A LDA #20
+				0x8D, 0x00, 0xC0, // 800C STA $C000  IRQ latch
+				0x8D, 0x01, 0xC0, // 800F STA $C001  reload
+				0x8D, 0x01, 0xE0, // 8012 STA $E001  enable
+				0x58,             // 8015 CLI
+				0xA9, 0x10,       // 8016 LDA #$10  toggle A12 through PPUADDR too
+				0x8D, 0x06, 0x20, // 8018 STA $2006
+				0x8D, 0x06, 0x20, // 801B STA $2006
+				0xA9, 0x00,       // 801E LDA #$00
+				0x8D, 0x06, 0x20, // 8020 STA $2006
+				0x8D, 0x06, 0x20, // 8023 STA $2006
+				0x4C, 0x16, 0x80, // 8026 JMP $8016
+			};
+			memcpy(rom, prog, sizeof(prog));
+			const uint8_t irq[] = {
+				0x8D, 0x00, 0xE0, // E000 STA $E000  acknowledge
+				0x8D, 0x01, 0xE0, // E003 STA $E001
+				0xE6, 0x10,       // E006 INC $10
+				0x40,             // E008 RTI
+			};
+			memcpy(rom + 0x6000, irq, sizeof(irq));
+			rom[0x7FFE] = 0x00;
+			rom[0x7FFF] = 0xE0;
+
+			// Background/sprite tables both ways round, 8x16 sprites, with and without PPUADDR writes
+			for (uint8_t ctrl : { 0x08, 0x10, 0x20 }) {
+				for (int ppuAddr = 0; ppuAddr < 2; ppuAddr++) {
+					memcpy(rom, prog, sizeof(prog));
+					rom[1] = ctrl;
+					if (!ppuAddr) {
+						rom[0x16] = 0x4C; // 8016 JMP $8016
+						rom[0x17] = 0x16;
+						rom[0x18] = 0x80;
+					}
+					std::vector<uint64_t> irqCycles[2];
+					for (int batching = 0; batching < 2; batching++) {
+						SharedContext runCtx;
+						Nes runNes(runCtx);
+						std::vector<uint32_t> frame(256 * 240);
+						LoadProgram(runNes, rom, frame, new MMC3(*runNes.bus_, 2, 1));
+						runNes.ppu_->reset();
+						runNes.ppu_->renderer->m_a12Batching = batching == 1;
+						runNes.cart_->mapper->SetMirrorMode(MapperBase::VERTICAL);
+						runNes.cart_->mapper->RecomputeMappings();
+						runNes.bus_->ramMapper.cpuRAM[0x10] = 0;
+						uint8_t count = 0;
+						while (runNes.cpu_->GetCycleCount() < 100000) {
+							runNes.clock();
+							if (runNes.bus_->ramMapper.cpuRAM[0x10] != count) {
+								count = runNes.bus_->ramMapper.cpuRAM[0x10];
+								irqCycles[batching].push_back(runNes.cpu_->GetCycleCount());
+							}
+						}
+					}
+					Assert::IsTrue(irqCycles[0].size() >= 3);
+					Assert::IsTrue(irqCycles[0] == irqCycles[1]);
+				}
+			}
+		}
+
+		// RendererScanline against the dot-by-dot reference, with mid-line writes, sprites, index output and an MMC3
+		TEST_METHOD(TestScanlineRendererMatchesLoopy)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xA9, 0x28,       // 8000 LDA #$28  8x16 sprites, sprites at $1000
+				0x8D, 0x00, 0x20, // 8002 STA $2000
+				0xA9, 0x14,       // 8005 LDA #20
+				0x8D, 0x00, 0xC0, // 8007 STA $C000  MMC3 IRQ every 20 lines
+				0x8D, 0x01, 0xC0, // 800A STA $C001
+				0x8D, 0x01, 0xE0, // 800D STA $E001
+				0x58,             // 8010 CLI
+				0xE8,             // 8011 INX
+				0x8A,             // 8012 TXA
+				0x09, 0x10,       // 8014 ORA #$10  sprites on, cycle through emphasis, grayscale, clipping and background off
+				0x8D, 0x01, 0x20, // 8016 STA $2001
+				0x8D, 0x05, 0x20, // 8019 STA $2005  and scroll
+				0x8D, 0x05, 0x20, // 801C STA $2005
+				0xA0, 0xFF,       // 801E LDY #$FF
+				0x88,             // 8020 DEY       leave most lines alone
+				0xD0, 0xFD,       // 8021 BNE $8020
+				0xAD, 0x02, 0x20, // 8023 LDA $2002
+				0x29, 0x40,       // 8026 AND #$40  count the sprite 0 hits seen
+				0xF0, 0x02,       // 8028 BEQ $802C
+				0xE6, 0x11,       // 802A INC $11
+				0x4C, 0x11, 0x80, // 802C JMP $8011
+			};
+			memcpy(rom, prog, sizeof(prog));
+			const uint8_t irq[] = {
+				0x8D, 0x00, 0xE0, // E000 STA $E000
+				0x8D, 0x01, 0xE0, // E003 STA $E001
+				0xE6, 0x10,       // E006 INC $10
+				0x40,             // E008 RTI
+			};
+			memcpy(rom + 0x6000, irq, sizeof(irq));
+			rom[0x7FFE] = 0x00;
+			rom[0x7FFF] = 0xE0;
+
+			for (int indexed = 0; indexed < 2; indexed++) {
+				std::vector<uint32_t> frames[2];
+				std::vector<uint16_t> indices[2];
+				uint64_t irqCycle[2] = {};
+				uint8_t status[2] = {};
+				uint8_t hits[2] = {};
+				uint64_t lines[2] = {};
+				// 0 = RendererLoopy only, 1 = RendererScanline
+				for (int mode = 0; mode < 2; mode++) {
+					SharedContext runCtx;
+					Nes runNes(runCtx);
+					frames[mode].assign(256 * 240, 0);
+					indices[mode].assign(256 * 240, 0);
+					LoadProgram(runNes, rom, frames[mode], new MMC3(*runNes.bus_, 2, 1));
+					runNes.ppu_->reset();
+					runNes.ppu_->SetScanlineRenderer(mode != 0);
+					runNes.ppu_->renderer->m_tileSpans = false;
+					if (indexed) runNes.ppu_->SetIndexBuffer(indices[mode].data());
+					uint32_t seed = 4242;
+					auto next = [&]() { seed = seed * 1103515245 + 12345; return (uint8_t)(seed >> 16); };
+					for (auto& b : runNes.cart_->mapper->m_chrData) b = next();
+					for (auto& b : runNes.cart_->mapper->_vram) b = next();
+					for (auto& b : runNes.ppu_->paletteTable) b = next() & 0x3F;
+					for (auto& b : runNes.ppu_->oam) b = next();
+					// Grayscale has to change the backdrop, it doesn't apply where the background is hidden
+					runNes.ppu_->paletteTable[0] = 0x1A;
+					// Sprite 0 mid-screen, where most lines are rendered whole
+					runNes.ppu_->oam[0] = 100;
+					runNes.ppu_->oam[3] = 120;
+					runNes.cart_->mapper->SetMirrorMode(MapperBase::VERTICAL);
+					runNes.cart_->mapper->RecomputeMappings();
+					runNes.bus_->ramMapper.cpuRAM[0x10] = 0;
+					runNes.bus_->ramMapper.cpuRAM[0x11] = 0;
+					uint8_t irqs = 0;
+					while (runNes.cpu_->GetCycleCount() < 120000) {
+						runNes.clock();
+						if (runNes.bus_->ramMapper.cpuRAM[0x10] != irqs) {
+							irqs = runNes.bus_->ramMapper.cpuRAM[0x10];
+							irqCycle[mode] = irqCycle[mode] * 31 + runNes.cpu_->GetCycleCount();
+						}
+					}
+					runNes.ppu_->CatchUp();
+					status[mode] = runNes.ppu_->GetPPUStatus();
+					hits[mode] = runNes.bus_->ramMapper.cpuRAM[0x11];
+					lines[mode] = runNes.ppu_->lineRenderer->linesRendered();
+				}
+				Assert::AreNotEqual((uint64_t)0, irqCycle[0]);
+				Assert::AreNotEqual((uint8_t)0, hits[0]);
+				// Otherwise the frames match because RendererLoopy did them all. Register writes are
+				// hundreds of dots apart, so nearly every visible line gets to RendererScanline.
+				const uint64_t dots = 120000 * 3;
+				const uint64_t visibleLines = dots / (341 * 262) * 240 + dots % (341 * 262) / 341;
+				Assert::AreEqual((uint64_t)0, lines[0]);
+				Assert::IsTrue(lines[1] >= visibleLines - visibleLines / 50);
+				Assert::IsTrue(lines[1] <= visibleLines);
+				Assert::AreEqual(irqCycle[0], irqCycle[1]);
+				Assert::AreEqual(status[0], status[1]);
+				Assert::AreEqual(hits[0], hits[1]);
+				Assert::IsTrue(frames[0] == frames[1]);
+				Assert::IsTrue(indices[0] == indices[1]);
+			}
+		}
+
+		// Every pair of bitplane bytes decodes to the same pixels as testing the bits one at a time
+		TEST_METHOD(TestDecodeTileRowMatchesBitplanes)
+		{
+			for (int low = 0; low < 256; low++) {
+				for (int high = 0; high < 256; high++) {
+					uint64_t pixels = RendererLoopy::DecodeTileRow((uint8_t)low, (uint8_t)high);
+					for (int col = 0; col < 8; col++) {
+						uint8_t expected = ((low >> (7 - col)) & 1) | (((high >> (7 - col)) & 1) << 1);
+						Assert::AreEqual(expected, (uint8_t)(pixels >> (col * 8)));
+					}
+				}
+			}
+		}
+
+		// The PPU only copies its state out for the debug windows when asked, and the copy is never torn
+		TEST_METHOD(TestPPUSnapshotOnDemand)
+		{
+			uint8_t rom[0x8000] = {};
+			rom[0] = 0x4C; rom[1] = 0x00; rom[2] = 0x80; // JMP $8000
+			SharedContext runCtx;
+			Nes runNes(runCtx);
+			std::vector<uint32_t> frame(256 * 240);
+			LoadProgram(runNes, rom, frame);
+			for (int i = 0; i < 0x2000; i++) runNes.cart_->mapper->m_chrData[i] = (uint8_t)(i * 7 + (i >> 8));
+			runNes.cart_->mapper->RecomputeMappings();
+			for (int i = 0; i < 32; i++) runNes.ppu_->paletteTable[i] = (uint8_t)(i + 1);
+			DebuggerContext* dbg = runCtx.debugger_context;
+
+			auto runFrames = [&](int frames) {
+				uint64_t end = runNes.cpu_->GetCycleCount() + 29781 * frames;
+				while (runNes.cpu_->GetCycleCount() < end) runNes.clock();
+				runNes.ppu_->CatchUp();
+			};
+			// Nobody asked, nothing published
+			runFrames(2);
+			dbg->RefreshPPUState();
+			Assert::AreEqual((uint8_t)0, dbg->ppuState.palette[1]);
+			Assert::AreEqual((uint8_t)0, dbg->ppuState.chrMemory[0x1234]);
+
+			dbg->RequestPPUSnapshot();
+			runFrames(1);
+			Assert::IsFalse(dbg->PPUSnapshotWanted());
+			dbg->RefreshPPUState();
+			for (int i = 0; i < 0x2000; i++) {
+				Assert::AreEqual(runNes.cart_->mapper->m_chrData[i], dbg->ppuState.chrMemory[i]);
+			}
+			Assert::AreEqual((uint8_t)2, dbg->ppuState.palette[1]);
+
+			// A reader racing a writer always gets one whole snapshot
+			std::unique_ptr<DebuggerContext> shared = std::make_unique<DebuggerContext>();
+			DebuggerContext& context = *shared;
+			std::atomic<bool> done{ false };
+			std::thread writer([&]() {
+				for (int n = 1; n <= 2000; n++) {
+					DebuggerContext::PPUState& state = context.BeginPPUSnapshot();
+					state.chrMemory.fill((uint8_t)n);
+					state.palette.fill((uint8_t)n);
+					context.PublishPPUSnapshot();
+				}
+				done = true;
+			});
+			int torn = 0;
+			while (!done) {
+				context.RefreshPPUState();
+				uint8_t n = context.ppuState.chrMemory[0];
+				for (uint8_t b : context.ppuState.chrMemory) if (b != n) torn++;
+				for (uint8_t b : context.ppuState.palette) if (b != n) torn++;
+			}
+			writer.join();
+			Assert::AreEqual(0, torn);
+			context.RefreshPPUState();
+			Assert::AreEqual((uint8_t)(2000 & 0xFF), context.ppuState.chrMemory[0x1FFF]);
+		}
+
+		TEST_METHOD(TestTripleBufferHandoff)
+		{
+			SharedContext ctx;
+			Assert::IsNull(ctx.WaitForNewFrame(0));
+
+			// Three frames published while the UI looks away, it gets the last and the two before are dropped
+			const uint32_t* published[3];
+			for (uint32_t n = 1; n <= 3; n++) {
+				uint32_t* back = ctx.GetBackBuffer();
+				Assert::IsTrue(back != ctx.GetFrontBuffer());
+				std::fill(back, back + WIDTH * HEIGHT, n);
+				published[n - 1] = back;
+				ctx.SwapBuffers();
+			}
+			const uint32_t* frame = ctx.WaitForNewFrame(0);
+			Assert::IsTrue(frame == published[2]);
+			Assert::AreEqual(3u, frame[0]);
+			Assert::AreEqual((uint64_t)3, ctx.GetFrontFrameInfo().sequence);
+			Assert::AreEqual((uint64_t)2, ctx.GetDroppedFrames());
+			Assert::IsNull(ctx.WaitForNewFrame(0));
+			// Drawing the next frame never touches the one on screen
+			Assert::IsTrue(ctx.GetBackBuffer() != frame);
+			ctx.SwapBuffers();
+			ctx.SwapBuffers();
+			ctx.WaitForNewFrame(0);
+			Assert::AreEqual((uint64_t)5, ctx.GetFrontFrameInfo().sequence);
+			Assert::AreEqual((uint64_t)3, ctx.GetDroppedFrames());
+
+			// Core and UI running flat out: every frame the UI gets is whole and newer than the last
+			SharedContext shared;
+			const uint32_t frames = 3000;
+			std::thread core([&]() {
+				for (uint32_t n = 1; n <= frames; n++) {
+					uint32_t* back = shared.GetBackBuffer();
+					std::fill(back, back + WIDTH * HEIGHT, n);
+					shared.SwapBuffers();
+				}
+			});
+			int torn = 0;
+			int outOfOrder = 0;
+			uint32_t last = 0;
+			uint64_t seen = 0;
+			while (last < frames) {
+				const uint32_t* f = shared.WaitForNewFrame(1000);
+				Assert::IsNotNull(f);
+				uint32_t n = f[0];
+				for (int i = 0; i < WIDTH * HEIGHT; i += 97) if (f[i] != n) torn++;
+				if (n <= last || shared.GetFrontFrameInfo().sequence != n) outOfOrder++;
+				last = n;
+				seen++;
+			}
+			core.join();
+			Assert::AreEqual(0, torn);
+			Assert::AreEqual(0, outOfOrder);
+			Assert::AreEqual((uint64_t)frames, seen + shared.GetDroppedFrames());
+		}
+
+		TEST_METHOD(TestSaveToBufferRoundTrip)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xA9, 0x08,       // 8000 LDA #$08  sprites at $1000
+				0x8D, 0x00, 0x20, // 8002 STA $2000
+				0xA9, 0x1E,       // 8005 LDA #$1E
+				0x8D, 0x01, 0x20, // 8007 STA $2001
+				0xA9, 0x14,       // 800A LDA #20
+				0x8D, 0x00, 0xC0, // 800C STA $C000  IRQ latch
+				0x8D, 0x01, 0xC0, // 800F STA $C001  reload
+				0x8D, 0x01, 0xE0, // 8012 STA $E001  enable
+				0x58,             // 8015 CLI
+				0xE6, 0x11,       // 8016 INC $11
+				0xA5, 0x11,       // 8018 LDA $11
+				0x8D, 0x05, 0x20, // 801A STA $2005
+				0x4C, 0x16, 0x80, // 801D JMP $8016
+			};
+			memcpy(rom, prog, sizeof(prog));
+			const uint8_t irq[] = {
+				0x8D, 0x00, 0xE0, // E000 STA $E000  acknowledge
+				0x8D, 0x01, 0xE0, // E003 STA $E001
+				0xE6, 0x10,       // E006 INC $10
+				0x40,             // E008 RTI
+			};
+			memcpy(rom + 0x6000, irq, sizeof(irq));
+			rom[0x7FFE] = 0x00;
+			rom[0x7FFF] = 0xE0;
+
+			SharedContext runCtx;
+			Nes runNes(runCtx);
+			std::vector<uint32_t> frame(256 * 240);
+			LoadProgram(runNes, rom, frame, new MMC3(*runNes.bus_, 2, 1));
+			runNes.ppu_->reset();
+			for (int i = 0; i < 0x2000; i++) runNes.cart_->mapper->m_chrData[i] = (uint8_t)(i * 13 + (i >> 7));
+			for (int i = 0; i < 0x800; i++) runNes.cart_->mapper->_vram[i] = (uint8_t)(i * 5);
+			for (int i = 0; i < 32; i++) runNes.ppu_->paletteTable[i] = (uint8_t)(i * 3 & 0x3F);
+			runNes.cart_->mapper->SetMirrorMode(MapperBase::VERTICAL);
+			runNes.cart_->mapper->RecomputeMappings();
+			auto runTo = [&](uint64_t cycle) {
+				while (runNes.cpu_->GetCycleCount() < cycle) runNes.clock();
+				runNes.ppu_->CatchUp();
+			};
+			runTo(70000);
+
+			StateBuffer state;
+			runNes.SaveToBuffer(state);
+			uint64_t savedCycle = runNes.cpu_->GetCycleCount();
+			// Same layout as a save file
+			std::ostringstream os(std::ios::binary);
+			Serializer serializer;
+			serializer.StartSerialization(os);
+			runNes.Serialize(serializer);
+			std::string file = os.str();
+			Assert::AreEqual(file.size(), state.size);
+
+			runTo(savedCycle + 29781 * 2);
+			std::vector<uint32_t> expectedFrame = frame;
+			auto expectedRam = runNes.bus_->ramMapper.cpuRAM;
+			uint64_t endCycle = runNes.cpu_->GetCycleCount();
+			Assert::IsTrue(expectedRam[0x10] > 0);
+
+			StateBuffer fromFile;
+			fromFile.bytes.assign(file.begin(), file.end());
+			fromFile.size = file.size();
+			for (const StateBuffer* source : { &state, &fromFile }) {
+				runNes.LoadFromBuffer(*source);
+				Assert::AreEqual(savedCycle, runNes.cpu_->GetCycleCount());
+				std::fill(frame.begin(), frame.end(), 0);
+				runTo(endCycle);
+				Assert::IsTrue(frame == expectedFrame);
+				Assert::IsTrue(expectedRam == runNes.bus_->ramMapper.cpuRAM);
+			}
+
+			// Saving again reuses the buffer
+			const uint8_t* data = state.data();
+			runNes.SaveToBuffer(state);
+			Assert::IsTrue(data == state.data());
+			Assert::AreEqual(file.size(), state.size);
+
+			bool threw = false;
+			StateBuffer truncated = state;
+			truncated.size -= 1;
+			try {
+				runNes.LoadFromBuffer(truncated);
+			}
+			catch (const std::runtime_error&) {
+				threw = true;
+			}
+			Assert::IsTrue(threw);
+		}
+
+		TEST_METHOD(TestRewindStepsBack)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xA9, 0x1E,       // 8000 LDA #$1E
+				0x8D, 0x01, 0x20, // 8002 STA $2001
+				0xE6, 0x10,       // 8005 INC $10
+				0xD0, 0xFC,       // 8007 BNE $8005
+				0xE6, 0x11,       // 8009 INC $11
+				0xA6, 0x11,       // 800B LDX $11
+				0x9D, 0x00, 0x03, // 800D STA $0300,X
+				0x8E, 0x05, 0x20, // 8010 STX $2005
+				0x4C, 0x05, 0x80, // 8013 JMP $8005
+			};
+			memcpy(rom, prog, sizeof(prog));
+			SharedContext runCtx;
+			Nes runNes(runCtx);
+			std::vector<uint32_t> frame(256 * 240);
+			LoadProgram(runNes, rom, frame);
+			auto runFrame = [&]() {
+				while (!runNes.frameReady()) runNes.clock();
+				runNes.ppu_->renderer->m_frameTick = false;
+			};
+
+			struct Capture {
+				uint64_t cycle;
+				std::array<uint8_t, 0x800> ram;
+				size_t prgRam;
+			};
+			for (size_t budget : { (size_t)1 << 20, (size_t)600 }) {
+				LoadProgram(runNes, rom, frame);
+				RewindBuffer rewind(budget, 3);
+				Assert::IsFalse(rewind.StepBack(runNes));
+				std::vector<Capture> captures;
+				for (int f = 1; f <= 60; f++) {
+					runFrame();
+					// PRG-RAM showing up halfway makes the states different sizes
+					if (f == 31) runNes.cart_->mapper->m_prgRamData.assign(0x2000, 0x5A);
+					rewind.OnFrame(runNes);
+					if (f % 3 == 0) {
+						captures.push_back({ runNes.cpu_->GetCycleCount(), runNes.bus_->ramMapper.cpuRAM, runNes.cart_->mapper->m_prgRamData.size() });
+					}
+				}
+				size_t count = rewind.GetCount();
+				if (budget > 600) {
+					Assert::AreEqual(captures.size(), count);
+					// Only a few bytes of RAM and the CPU/PPU registers change between captures
+					Assert::IsTrue(rewind.GetLastDeltaBytes() < 200);
+				}
+				else {
+					Assert::IsTrue(count > 1 && count < captures.size());
+					// The newest capture whole, and the deltas that fit
+					StateBuffer whole;
+					runNes.SaveToBuffer(whole);
+					Assert::IsTrue(rewind.GetBytesUsed() <= whole.size + 600);
+				}
+				for (size_t i = 0; i < count + 2; i++) {
+					Assert::IsTrue(rewind.StepBack(runNes));
+					// Past the oldest it stays on the oldest
+					const Capture& expected = captures[captures.size() - 1 - (std::min)(i, count - 1)];
+					Assert::AreEqual(expected.cycle, runNes.cpu_->GetCycleCount());
+					Assert::IsTrue(expected.ram == runNes.bus_->ramMapper.cpuRAM);
+					Assert::AreEqual(expected.prgRam, runNes.cart_->mapper->m_prgRamData.size());
+				}
+				Assert::AreEqual((size_t)1, rewind.GetCount());
+
+				// Playing on from there captures on top of it
+				runFrame();
+				runFrame();
+				runFrame();
+				rewind.OnFrame(runNes);
+				rewind.OnFrame(runNes);
+				rewind.OnFrame(runNes);
+				uint64_t cycle = runNes.cpu_->GetCycleCount();
+				Assert::AreEqual((size_t)2, rewind.GetCount());
+				runFrame();
+				Assert::IsTrue(rewind.StepBack(runNes));
+				Assert::AreEqual(cycle, runNes.cpu_->GetCycleCount());
+				Assert::IsTrue(rewind.StepBack(runNes));
+				Assert::AreEqual(captures[captures.size() - count].cycle, runNes.cpu_->GetCycleCount());
+			}
+
+			// Stopping partway, the capture rewound to is still there to go back to after playing on
+			LoadProgram(runNes, rom, frame);
+			RewindBuffer rewind(1 << 20, 1);
+			std::vector<uint64_t> cycles;
+			for (int f = 0; f < 10; f++) {
+				runFrame();
+				rewind.OnFrame(runNes);
+				cycles.push_back(runNes.cpu_->GetCycleCount());
+			}
+			rewind.StepBack(runNes);
+			rewind.StepBack(runNes);
+			Assert::AreEqual(cycles[8], runNes.cpu_->GetCycleCount());
+			runFrame();
+			rewind.OnFrame(runNes);
+			uint64_t after = runNes.cpu_->GetCycleCount();
+			Assert::AreEqual((size_t)10, rewind.GetCount());
+			for (uint64_t expected : { after, cycles[8], cycles[7], cycles[6] }) {
+				Assert::IsTrue(rewind.StepBack(runNes));
+				Assert::AreEqual(expected, runNes.cpu_->GetCycleCount());
+			}
+		}
+
+		// Every frame shown with run-ahead is the one a plain run shows that many frames later, and the real
+		// frames (RAM, audio) are the same as if it was off
+		TEST_METHOD(TestRunAheadShowsFramesAhead)
+		{
+			std::vector<uint8_t> file(16 + 0x8000 + 0x2000);
+			const uint8_t header[] = { 'N', 'E', 'S', 0x1A, 2, 1 };
+			memcpy(file.data(), header, sizeof(header));
+			uint8_t* rom = file.data() + 16;
+			const uint8_t prog[] = {
+				0xA9, 0x01,       // 8000 LDA #$01
+				0x8D, 0x15, 0x40, // 8002 STA $4015  pulse 1 on
+				0xA9, 0x1E,       // 8005 LDA #$1E
+				0x8D, 0x01, 0x20, // 8007 STA $2001
+				0xA9, 0x80,       // 800A LDA #$80
+				0x8D, 0x00, 0x20, // 800C STA $2000  NMI on
+				0x4C, 0x0F, 0x80, // 800F JMP $800F
+			};
+			memcpy(rom, prog, sizeof(prog));
+			const uint8_t nmi[] = {
+				0xE6, 0x10,       // E000 INC $10
+				0x8D, 0x16, 0x40, // E002 STA $4016  latch the controllers
+				0xA2, 0x08,       // E005 LDX #$08
+				0xAD, 0x17, 0x40, // E007 LDA $4017  controller 2 into $11
+				0x4A,             // E00A LSR A
+				0x26, 0x11,       // E00B ROL $11
+				0xCA,             // E00D DEX
+				0xD0, 0xF7,       // E00E BNE $E007
+				0xA5, 0x10,       // E010 LDA $10
+				0x8D, 0x05, 0x20, // E012 STA $2005
+				0xA5, 0x11,       // E015 LDA $11
+				0x8D, 0x05, 0x20, // E017 STA $2005  scrolled down by what controller 2 holds
+				0xA5, 0x10,       // E01A LDA $10
+				0x8D, 0x02, 0x40, // E01C STA $4002  pitch follows the frame
+				0xA9, 0xBF,       // E01F LDA #$BF
+				0x8D, 0x00, 0x40, // E021 STA $4000
+				0xA9, 0x08,       // E024 LDA #$08
+				0x8D, 0x03, 0x40, // E026 STA $4003
+				0x40,             // E029 RTI
+			};
+			memcpy(rom + 0x6000, nmi, sizeof(nmi));
+			rom[0x7FFA] = 0x00; rom[0x7FFB] = 0xE0;
+			rom[0x7FFC] = 0x00; rom[0x7FFD] = 0x80;
+			for (int i = 0; i < 0x2000; i++) file[16 + 0x8000 + i] = (uint8_t)(i * 29 + (i >> 5));
+			std::string path = (std::filesystem::temp_directory_path() / "BlueNESRunAhead.nes").string();
+			{
+				std::ofstream out(path, std::ios::binary);
+				out.write((const char*)file.data(), file.size());
+			}
+
+			auto boot = [&](Nes& target, std::vector<uint32_t>& frame) {
+				target.cart_->LoadROM(path);
+				target.apu_->set_dmc_read_callback([&target](uint16_t address) -> uint8_t {
+					return target.bus_->read(address);
+				});
+				target.ppu_->setBuffer(frame.data());
+				target.ppu_->reset();
+				target.cpu_->PowerCycle();
+				for (int i = 0; i < 0x800; i++) target.cart_->mapper->_vram[i] = (uint8_t)(i * 7);
+				for (int i = 0; i < 32; i++) target.ppu_->paletteTable[i] = (uint8_t)((i * 5) & 0x3F);
+				// Not the built-in colors, the second instance has to draw with ours
+				uint8_t rgb[64 * 3];
+				for (int i = 0; i < 64 * 3; i++) rgb[i] = (uint8_t)(i * 37 + 11);
+				target.ppu_->SetPalette(rgb, 64);
+				// Both controllers held the whole time, the frames ahead have to see both
+				target.input_->SetState({ 0x81, 0, 0x5A, 0 });
+			};
+			auto runFrame = [](Nes& target) {
+				target.ppu_->renderer->m_frameTick = false;
+				while (!target.frameReady()) target.clock();
+				target.endAudioFrame();
+				std::vector<float> audio = target.audioBuffer;
+				target.audioBuffer.clear();
+				return audio;
+			};
+
+			const int frames = 12;
+			std::vector<std::vector<uint32_t>> shown;
+			std::vector<std::vector<float>> audio;
+			std::vector<std::array<uint8_t, 0x800>> ram;
+			{
+				SharedContext runCtx;
+				Nes runNes(runCtx);
+				std::vector<uint32_t> frame(256 * 240);
+				boot(runNes, frame);
+				for (int f = 0; f < frames + RunAhead::MAX_FRAMES; f++) {
+					audio.push_back(runFrame(runNes));
+					shown.push_back(frame);
+					ram.push_back(runNes.bus_->ramMapper.cpuRAM);
+				}
+				runNes.cart_->unload(false);
+			}
+			Assert::IsTrue(shown[4] != shown[5]);
+			Assert::IsTrue(audio[4] != audio[5]);
+
+			for (int secondInstance = 0; secondInstance < 2; secondInstance++) {
+				for (int ahead = 1; ahead <= RunAhead::MAX_FRAMES; ahead++) {
+					SharedContext runCtx;
+					Nes runNes(runCtx);
+					std::vector<uint32_t> frame(256 * 240);
+					std::vector<uint32_t> aheadFrame(256 * 240);
+					boot(runNes, frame);
+					RunAhead runAhead(runNes);
+					runAhead.SetFrames(ahead);
+					runAhead.SetSecondInstance(secondInstance == 1, path);
+					Assert::AreEqual(secondInstance == 1, runAhead.IsSecondInstance());
+					// A breakpoint the frames ahead run into mustn't stop them. If it did, the core
+					// falls through the pause instead of waiting and it shows up in hit_breakpoint.
+					DebuggerContext* dbg = runCtx.debugger_context;
+					runCtx.is_running = false;
+					runNes.cpu_->SetDebuggerAttached(true);
+					for (int f = 0; f < frames; f++) {
+						runNes.ppu_->SetSkipOutput(true);
+						std::vector<float> samples = runFrame(runNes);
+						dbg->SetBreakpoint(0xE000, true);
+						runAhead.Start(aheadFrame.data());
+						runAhead.Finish();
+						dbg->SetBreakpoint(0xE000, false);
+						Assert::IsTrue(samples == audio[f]);
+						Assert::IsTrue(ram[f] == runNes.bus_->ramMapper.cpuRAM);
+						Assert::IsTrue(aheadFrame == shown[f + ahead]);
+					}
+					Assert::IsTrue(runAhead.GetAverageOverheadNs() > 0);
+					Assert::IsFalse(dbg->hit_breakpoint.load());
+					Assert::IsTrue(runNes.cpu_->IsDebuggerAttached());
+					runNes.cart_->unload(false);
+				}
+			}
+			std::filesystem::remove(path);
+		}
+
+		TEST_METHOD(TestChunkedStateSkipsUnknownChunks)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xA9, 0x1E,       // 8000 LDA #$1E
+				0x8D, 0x01, 0x20, // 8002 STA $2001
+				0xE6, 0x10,       // 8005 INC $10
+				0xA5, 0x10,       // 8007 LDA $10
+				0x8D, 0x00, 0xA0, // 8009 STA $A000  mirroring
+				0x8D, 0x05, 0x20, // 800C STA $2005
+				0x8D, 0x00, 0x60, // 800F STA $6000
+				0x4C, 0x05, 0x80, // 8012 JMP $8005
+			};
+			memcpy(rom, prog, sizeof(prog));
+
+			SharedContext runCtx;
+			Nes runNes(runCtx);
+			std::vector<uint32_t> frame(256 * 240);
+			LoadProgram(runNes, rom, frame, new MMC3(*runNes.bus_, 2, 1));
+			runNes.cart_->mapper->m_prgRamData.resize(0x2000);
+			runNes.cart_->mapper->RecomputeMappings();
+			for (int i = 0; i < 0x800; i++) runNes.cart_->mapper->_vram[i] = (uint8_t)(i * 7);
+			auto runTo = [&](uint64_t cycle) {
+				while (runNes.cpu_->GetCycleCount() < cycle) runNes.clock();
+				runNes.ppu_->CatchUp();
+			};
+			runTo(50000);
+
+			StateBuffer state;
+			runNes.SaveToBuffer(state);
+			uint64_t savedCycle = runNes.cpu_->GetCycleCount();
+			HeaderState header;
+			memcpy(&header, state.data(), sizeof(header));
+			Assert::AreEqual((uint32_t)STATE_MAGIC, header.magic);
+			Assert::AreEqual((uint32_t)STATE_VERSION, header.version);
+
+			struct Span { size_t at; size_t bytes; };
+			std::vector<Span> chunks;
+			size_t at = sizeof(HeaderState);
+			while (at < state.size) {
+				at = (at + 7) & ~(size_t)7;
+				Assert::AreEqual((size_t)0, at % 8);
+				ChunkHeader chunk;
+				memcpy(&chunk, state.data() + at, sizeof(chunk));
+				chunks.push_back({ at, sizeof(chunk) + chunk.size });
+				at += sizeof(chunk) + chunk.size;
+			}
+			Assert::AreEqual(state.size, at);
+			Assert::AreEqual((size_t)8, chunks.size()); // CPU PPU RAM DMA PRAM VRAM MMC3 APU, CHR is ROM
+
+			runTo(savedCycle + 29781 * 2);
+			std::vector<uint32_t> expectedFrame = frame;
+			auto expectedRam = runNes.bus_->ramMapper.cpuRAM;
+			auto expectedPrgRam = runNes.cart_->mapper->m_prgRamData;
+			uint64_t endCycle = runNes.cpu_->GetCycleCount();
+			Assert::IsTrue(expectedPrgRam[0] != 0);
+
+			auto append = [](StateBuffer& to, const uint8_t* data, size_t bytes) {
+				to.size = (to.size + 7) & ~(size_t)7;
+				to.bytes.resize(to.size + bytes);
+				memcpy(to.bytes.data() + to.size, data, bytes);
+				to.size += bytes;
+			};
+			auto loadAndCompare = [&](const StateBuffer& source) {
+				runNes.LoadFromBuffer(source);
+				Assert::AreEqual(savedCycle, runNes.cpu_->GetCycleCount());
+				std::fill(frame.begin(), frame.end(), 0);
+				runTo(endCycle);
+				Assert::IsTrue(frame == expectedFrame);
+				Assert::IsTrue(expectedRam == runNes.bus_->ramMapper.cpuRAM);
+				Assert::IsTrue(expectedPrgRam == runNes.cart_->mapper->m_prgRamData);
+			};
+
+			// Chunks from some later version in front, and the known ones backwards
+			StateBuffer shuffled;
+			append(shuffled, state.data(), sizeof(HeaderState));
+			uint8_t unknown[sizeof(ChunkHeader) + 5] = {};
+			ChunkHeader unknownHeader = {};
+			unknownHeader.tag = ChunkTag("ZZZZ");
+			unknownHeader.size = 5;
+			unknownHeader.version = 7;
+			memcpy(unknown, &unknownHeader, sizeof(unknownHeader));
+			append(shuffled, unknown, sizeof(unknown));
+			for (auto it = chunks.rbegin(); it != chunks.rend(); ++it) {
+				append(shuffled, state.data() + it->at, it->bytes);
+			}
+			append(shuffled, unknown, sizeof(unknown));
+			loadAndCompare(shuffled);
+
+			// Version 1, the same data with no header or chunks
+			StateBuffer unchunked;
+			uint32_t version = STATE_VERSION_UNCHUNKED;
+			append(unchunked, (const uint8_t*)&version, sizeof(version));
+			for (const Span& chunk : chunks) {
+				size_t end = unchunked.size;
+				unchunked.bytes.resize(end + chunk.bytes - sizeof(ChunkHeader));
+				memcpy(unchunked.bytes.data() + end, state.data() + chunk.at + sizeof(ChunkHeader), chunk.bytes - sizeof(ChunkHeader));
+				unchunked.size += chunk.bytes - sizeof(ChunkHeader);
+			}
+			loadAndCompare(unchunked);
+
+			// Loaded the way a save state file is
+			StateBuffer rollback;
+			auto throws = [&](const StateBuffer& source) {
+				try {
+					Serializer serializer;
+					serializer.StartDeserialization(source.data(), source.size);
+					runNes.DeserializeOrRollBack(serializer, rollback);
+				}
+				// What the serializer throws for a bad state. Anything else, like bad_alloc, fails the test.
+				catch (const std::runtime_error&) {
+					return true;
+				}
+				return false;
+			};
+			// A failed load leaves the machine exactly as it was, not partly loaded
+			runTo(endCycle + 1000);
+			StateBuffer before;
+			runNes.SaveToBuffer(before);
+			uint64_t beforeCycle = runNes.cpu_->GetCycleCount();
+			auto beforeRam = runNes.bus_->ramMapper.cpuRAM;
+			runTo(beforeCycle + 29781 * 2);
+			std::vector<uint32_t> laterFrame = frame;
+			auto laterRam = runNes.bus_->ramMapper.cpuRAM;
+			runNes.LoadFromBuffer(before);
+			auto unchanged = [&]() {
+				return runNes.cpu_->GetCycleCount() == beforeCycle && runNes.bus_->ramMapper.cpuRAM == beforeRam;
+			};
+			auto shorten = [&](const Span& chunk, uint32_t tag) {
+				StateBuffer copy = state;
+				ChunkHeader header;
+				memcpy(&header, copy.bytes.data() + chunk.at, sizeof(header));
+				Assert::IsTrue(header.tag == tag);
+				header.size -= 1;
+				memcpy(copy.bytes.data() + chunk.at, &header, sizeof(header));
+				return copy;
+			};
+			// A chunk shorter than what reads it doesn't run into the next one
+			Assert::IsTrue(throws(shorten(chunks[0], CHUNK_CPU)));
+			Assert::IsTrue(unchanged());
+			// The APU is read last, after everything else was loaded
+			Assert::IsTrue(throws(shorten(chunks.back(), CHUNK_APU)));
+			Assert::IsTrue(unchanged());
+			// Nor does one that's missing
+			StateBuffer noApu = state;
+			noApu.size = chunks.back().at;
+			Assert::IsTrue(throws(noApu));
+			Assert::IsTrue(unchanged());
+			// A damaged PRG-RAM length is caught before it's allocated, not 4GB later
+			StateBuffer hugePrgRam = state;
+			ChunkHeader prgRamHeader;
+			memcpy(&prgRamHeader, hugePrgRam.bytes.data() + chunks[4].at, sizeof(prgRamHeader));
+			Assert::IsTrue(prgRamHeader.tag == CHUNK_PRG_RAM);
+			uint32_t hugeLength = 0xFFFFFFF0;
+			memcpy(hugePrgRam.bytes.data() + chunks[4].at + sizeof(ChunkHeader), &hugeLength, sizeof(hugeLength));
+			Assert::IsTrue(throws(hugePrgRam));
+			Assert::IsTrue(unchanged());
+			Assert::AreEqual((size_t)0x2000, runNes.cart_->mapper->m_prgRamData.size());
+			// And plays on the same as if nothing had happened
+			std::fill(frame.begin(), frame.end(), 0);
+			runTo(beforeCycle + 29781 * 2);
+			Assert::IsTrue(frame == laterFrame);
+			Assert::IsTrue(laterRam == runNes.bus_->ramMapper.cpuRAM);
+			// Another game's state isn't loaded at all
+			runNes.LoadFromBuffer(state);
+			runNes.cart_->romHash = 0x1234;
+			runTo(endCycle);
+			Assert::IsTrue(throws(state));
+			Assert::AreEqual(endCycle, runNes.cpu_->GetCycleCount());
+			runNes.cart_->romHash = 0;
+		}
+
+		TEST_METHOD(TestSaveStateWriterWritesCompressedSlot)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xE6, 0x10,       // 8000 INC $10
+				0xA5, 0x10,       // 8002 LDA $10
+				0x8D, 0x00, 0x60, // 8004 STA $6000
+				0x4C, 0x00, 0x80, // 8007 JMP $8000
+			};
+			memcpy(rom, prog, sizeof(prog));
+			SharedContext runCtx;
+			Nes runNes(runCtx);
+			std::vector<uint32_t> frame(256 * 240);
+			LoadProgram(runNes, rom, frame);
+			runNes.cart_->mapper->m_prgRamData.resize(0x2000);
+			runNes.cart_->mapper->RecomputeMappings();
+			while (runNes.cpu_->GetCycleCount() < 20000) runNes.clock();
+
+			std::filesystem::path folder = std::filesystem::temp_directory_path();
+			std::filesystem::path path = folder / "BlueNESWriterTest.003";
+			std::filesystem::path temp = path;
+			temp += ".tmp";
+			std::filesystem::path later = folder / "BlueNESWriterTest.004";
+			std::filesystem::remove(later);
+			auto readFile = [](const std::filesystem::path& from) {
+				std::ifstream in(from, std::ios::binary);
+				return std::vector<uint8_t>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+			};
+
+			StateBuffer expected;
+			runNes.SaveToBuffer(expected);
+			uint64_t savedCycle = runNes.cpu_->GetCycleCount();
+			auto savedRam = runNes.bus_->ramMapper.cpuRAM;
+			{
+				SaveStateWriter writer(runCtx);
+				// The second write replaces the first
+				for (int i = 0; i < 2; i++) {
+					StateBuffer state = writer.TakeBuffer();
+					runNes.SaveToBuffer(state);
+					writer.Write(std::move(state), path, std::chrono::steady_clock::now());
+				}
+				writer.Flush();
+				Assert::IsFalse(std::filesystem::exists(temp));
+				Assert::IsFalse(runCtx.saveStateFailed.load());
+				// Snapshots go back into the buffers the writes are done with
+				StateBuffer reused = writer.TakeBuffer();
+				Assert::IsTrue(reused.bytes.size() >= expected.size);
+
+				std::vector<uint8_t> file = readFile(path);
+				Assert::AreEqual((uint32_t)file.size(), runCtx.saveStateBytes.load());
+				Assert::IsTrue(file.size() < expected.size / 4);
+				Assert::IsTrue(SaveStateWriter::IsCompressed(file.data(), file.size()));
+				Assert::IsFalse(SaveStateWriter::IsCompressed(expected.data(), expected.size));
+				StateBuffer loaded;
+				SaveStateWriter::Decompress(file.data(), file.size(), loaded);
+				Assert::AreEqual(expected.size, loaded.size);
+				while (runNes.cpu_->GetCycleCount() < 40000) runNes.clock();
+				runNes.LoadFromBuffer(loaded);
+				Assert::AreEqual(savedCycle, runNes.cpu_->GetCycleCount());
+				Assert::IsTrue(savedRam == runNes.bus_->ramMapper.cpuRAM);
+
+				bool threw = false;
+				file[file.size() / 2] ^= 0xFF;
+				try {
+					SaveStateWriter::Decompress(file.data(), file.size(), loaded);
+				}
+				catch (const std::runtime_error&) {
+					threw = true;
+				}
+				Assert::IsTrue(threw);
+
+				// Somewhere it can't be written, the old file stays
+				writer.Write(writer.TakeBuffer(), folder / "BlueNESMissingFolder" / "Test.000", std::chrono::steady_clock::now());
+				writer.Flush();
+				Assert::IsTrue(runCtx.saveStateFailed.load());
+
+				// Still queued when the writer goes away
+				StateBuffer last = writer.TakeBuffer();
+				runNes.SaveToBuffer(last);
+				writer.Write(std::move(last), later, std::chrono::steady_clock::now());
+			}
+			Assert::IsTrue(std::filesystem::exists(later));
+			Assert::IsFalse(runCtx.saveStateFailed.load());
+			std::filesystem::remove(path);
+			std::filesystem::remove(later);
+		}
+
+		// The catch-up PPU has to be indistinguishable from running it 3 dots per CPU cycle
+		TEST_METHOD(TestPPUCatchUpMatchesLockstep)
+		{
+			uint8_t rom[0x8000] = {};
+			const uint8_t prog[] = {
+				0xA9, 0x08,       // 8000 LDA #$08  sprites at $1000
+				0x8D, 0x00, 0x20, // 8002 STA $2000
+				0xA9, 0x1E,       // 8005 LDA #$1E
+				0x8D, 0x01, 0x20, // 8007 STA $2001
+				0xA9, 0x14,       // 800A LDA #20
+				0x8D, 0x00, 0xC0, // 800C STA $C000  IRQ latch
+				0x8D, 0x01, 0xC0, // 800F STA $C001  reload
+				0x8D, 0x01, 0xE0, // 8012 STA $E001  enable
+				0x58,             // 8015 CLI
+				0xAD, 0x02, 0x20, // 8016 LDA $2002
+				0x85, 0x12,       // 8019 STA $12
+				0x4C, 0x16, 0x80, // 801B JMP $8016
+			};
+			memcpy(rom, prog, sizeof(prog));
+			const uint8_t irq[] = {
+				0x8D, 0x00, 0xE0, // E000 STA $E000  acknowledge
+				0x8D, 0x01, 0xE0, // E003 STA $E001
+				0xE6, 0x10,       // E006 INC $10
+				0x40,             // E008 RTI
+			};
+			memcpy(rom + 0x6000, irq, sizeof(irq));
+			rom[0x7FFE] = 0x00;
+			rom[0x7FFF] = 0xE0;
+
+			std::vector<uint64_t> irqCycles[2];
+			std::vector<uint64_t> statusReads[2];
+			std::vector<uint32_t> frames[2];
+			for (int catchUp = 0; catchUp < 2; catchUp++) {
+				SharedContext runCtx;
+				Nes runNes(runCtx);
+				std::vector<uint32_t> frame(256 * 240);
+				LoadProgram(runNes, rom, frame, new MMC3(*runNes.bus_, 2, 1));
+				runNes.ppu_->reset();
+				runNes.ppuCatchUp = catchUp == 1;
+				for (int i = 0; i < 0x2000; i++) runNes.cart_->mapper->m_chrData[i] = (uint8_t)(i * 13 + (i >> 7));
+				for (int i = 0; i < 0x800; i++) runNes.cart_->mapper->_vram[i] = (uint8_t)(i * 5);
+				for (int i = 0; i < 32; i++) runNes.ppu_->paletteTable[i] = (uint8_t)(i * 3 & 0x3F);
+				const uint8_t sprite0[] = { 60, 1, 0, 80 };
+				memcpy(runNes.ppu_->oam.data(), sprite0, sizeof(sprite0));
+				runNes.cart_->mapper->SetMirrorMode(MapperBase::VERTICAL);
+				runNes.cart_->mapper->RecomputeMappings();
+				uint8_t lastIrq = 0;
+				uint8_t lastStatus = 0;
+				while (runNes.cpu_->GetCycleCount() < 29781 * 3) {
+					runNes.clock();
+					const auto& ram = runNes.bus_->ramMapper.cpuRAM;
+					if (ram[0x10] != lastIrq) {
+						lastIrq = ram[0x10];
+						irqCycles[catchUp].push_back(runNes.cpu_->GetCycleCount());
+					}
+					if (ram[0x12] != lastStatus) {
+						lastStatus = ram[0x12];
+						statusReads[catchUp].push_back(runNes.cpu_->GetCycleCount() << 8 | lastStatus);
+					}
+				}
+				runNes.ppu_->CatchUp();
+				frames[catchUp] = frame;
+			}
+			// Both IRQs a frame, VBlank, and sprite 0 hit set and cleared
+			Assert::IsTrue(irqCycles[0].size() > 10);
+			Assert::IsTrue(statusReads[0].size() > 6);
+			bool sawVBlank = false, sawHit = false;
+			for (uint64_t read : statusReads[0]) {
+				sawVBlank |= (read & 0x80) != 0;
+				sawHit |= (read & 0x40) != 0;
+			}
+			Assert::IsTrue(sawVBlank && sawHit);
+			Assert::IsTrue(irqCycles[0] == irqCycles[1]);
+			Assert::IsTrue(statusReads[0] == statusReads[1]);
+			Assert::IsTrue(frames[0] == frames[1]);
+		}
+
+		// Breakpoints don't depend on a debug window being open, only the fetch log does
+		TEST_METHOD(TestBreakpointPausesWithoutDebugWindow)
+		{
+			uint8_t rom[0x8000] = {};
+			rom[0] = 0xE8; // INX
+			rom[1] = 0x4C; rom[2] = 0x00; rom[3] = 0x80; // JMP $8000
+			SharedContext runCtx;
+			Nes runNes(runCtx);
+			std::vector<uint32_t> frame(256 * 240);
+			LoadProgram(runNes, rom, frame);
+			DebuggerContext* dbg = runCtx.debugger_context;
+
+			Assert::IsFalse(dbg->fetchLogging.load());
+			Assert::IsFalse(dbg->IsAttached());
+			dbg->ToggleBreakpoint(0x8001);
+			Assert::IsTrue(dbg->IsAttached());
+			dbg->ToggleBreakpoint(0x8001);
+			Assert::IsFalse(dbg->IsAttached());
+			dbg->SetBreakpoint(0x8001, true);
+			dbg->SetBreakpoint(0x8001, true);
+			Assert::IsTrue(dbg->IsAttached());
+
+			// What the core does once a frame
+			runNes.cpu_->SetDebuggerAttached(dbg->IsAttached());
+			std::thread core([&]() {
+				uint64_t end = runNes.cpu_->GetCycleCount() + 29781;
+				while (runNes.cpu_->GetCycleCount() < end) runNes.clock();
+			});
+			auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+			while (!dbg->hit_breakpoint.load() && std::chrono::steady_clock::now() < deadline) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			bool hit = dbg->hit_breakpoint.load();
+			bool paused = dbg->is_paused.load();
+			uint16_t pc = dbg->lastState.pc;
+			// Clearing the last one detaches, even though the same spot was set twice
+			dbg->SetBreakpoint(0x8001, false);
+			if (!hit) runCtx.is_running = false;
+			dbg->continue_requested = true;
+			core.join();
+			Assert::IsTrue(hit);
+			Assert::IsTrue(paused);
+			Assert::AreEqual((uint16_t)0x8001, pc);
+			Assert::IsFalse(dbg->IsAttached());
+		}
 	};
-}
\ No newline at end of file
+}
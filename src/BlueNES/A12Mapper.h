@@ -4,4 +4,6 @@
 class A12Mapper {
 public:
 	virtual void ClockIRQCounter(uint16_t ppu_address) = 0;
+	// Same, for a fetch that happened earlier, at the given PPU::GetCycleCount()
+	virtual void ClockIRQCounterAt(uint16_t ppu_address, uint64_t cycle) = 0;
 };
\ No newline at end of file
@@ -3,7 +3,10 @@
 #include <cstdint>
 #include <array>
 #include <functional>
+#include <climits>
+#include <algorithm>
 #include "Serializer.h"
+#include "BlipBuffer.h"
 
 class APU {
 public:
@@ -30,6 +33,27 @@ public:
         }
     }
 
+    // The weighted-sum mixer the tables replaced, kept for tests to measure them against.
+    // The 203-entry TND table is off from it by at most ~0.017.
+    static float mix_reference(uint8_t p1, uint8_t p2, uint8_t tr, uint8_t no, uint8_t dm) {
+        float tnd_sum = tr / 8227.0f + no / 12241.0f + dm / 22638.0f;
+        float tnd_out = 0.0f;
+        if (tnd_sum > 0) {
+            tnd_out = 159.79f / (1.0f / tnd_sum + 100.0f);
+        }
+        return (mix_pulse(p1 + p2) + tnd_out) * 1.3f;
+    }
+
+    // Mixes count samples of raw channel outputs (pulse 0-15, triangle 0-15, noise 0-15, DMC 0-127)
+    // into out. Two table loads and an add per sample, no branches.
+    static void mix_batch(const uint8_t* p1, const uint8_t* p2, const uint8_t* tr,
+        const uint8_t* no, const uint8_t* dm, float* out, size_t count) {
+        const MixerTables& tables = mixer_tables();
+        for (size_t i = 0; i < count; i++) {
+            out[i] = (tables.pulse[p1[i] + p2[i]] + tables.tnd_table[tnd_index(tr[i], no[i], dm[i])]) * 1.3f;
+        }
+    }
+
     void step_frame_sequencer() {
         clock_quarter_frame();
         clock_half_frame();
@@ -45,6 +69,7 @@ public:
 
         // Reset frame counter
         cycle_counter = 0;
+        pending_cycles = 0;
         frame_counter_mode = 0;
         frame_counter_irq_flag = false;
         frame_counter_step = 0;
@@ -147,7 +172,95 @@ public:
         cycle_counter++;
     }
 
+    // Same as calling step() cycles times, but runs in spans between frame sequencer events.
+    // Inside a span each channel jumps straight from one timer reload to the next, so this
+    // costs O(events) instead of O(cycles). step() stays the reference.
+    void step(uint32_t cycles) {
+        while (cycles > 0) {
+            uint32_t span = frame_counter_reset_delay > 0 ? 0 : cycles_to_frame_event();
+            if (span == 0) {
+                // The event cycle itself (or the $4017 reset delay) goes through the reference
+                step();
+                cycles--;
+                if (blip) {
+                    blip_time++;
+                    record_output();
+                }
+                continue;
+            }
+            if (span > cycles) {
+                span = cycles;
+            }
+            if (blip) {
+                // Stop on every change of the output so it lands on the right cycle
+                span = (std::min)(span, cycles_to_output_change());
+            }
+            // Pulse and noise only clock on even cycle_counter values
+            uint32_t evens = (cycle_counter & 1) ? span / 2 : (span + 1) / 2;
+            triangle.advance(span);
+            pulse1.advance(evens);
+            pulse2.advance(evens);
+            noise.advance(evens);
+            dmc.advance(span);
+            cycle_counter += span;
+            cycles -= span;
+            if (blip) {
+                blip_time += span;
+                record_output();
+            }
+        }
+    }
+
+    // Band-limited output. When set, every change of the mixed output is added to the buffer
+    // as a delta at blip_time (cycles since the owner last ended the audio frame).
+    BlipBuffer* blip = nullptr;
+    uint32_t blip_time = 0;
+    float blip_level = 0.0f;
+
+    void record_output() {
+        float level = mix_output();
+        if (level != blip_level) {
+            blip->AddDelta(blip_time, level - blip_level);
+            blip_level = level;
+        }
+    }
+
+    // Cycles the owner has clocked us for but we haven't run yet.
+    // Register reads and writes have to call catch_up() first.
+    uint32_t pending_cycles = 0;
+    // Set by register writes and the $4015 read that acknowledges the frame IRQ,
+    // anything that schedules around cycles_until_irq() has to look again.
+    bool timing_changed = false;
+
+    void catch_up() {
+        if (pending_cycles > 0) {
+            uint32_t cycles = pending_cycles;
+            pending_cycles = 0;
+            step(cycles);
+        }
+    }
+
+    // How many more step() calls can run before the APU could raise its IRQ line.
+    // Used for scheduling catch-ups and idle loop skips, so it only needs to be conservative.
+    int cycles_until_irq() const {
+        int frame = INT_MAX;
+        if (frame_counter_mode == 0 && !frame_counter_irq_inhibit) {
+            if (frame_counter_reset_delay > 0) {
+                frame = frame_counter_reset_delay;
+            }
+            else if (cycle_counter <= 29828) {
+                frame = 29828 - cycle_counter;
+            }
+            else {
+                // Runs out the sequence, wraps to 0 and counts up again
+                frame = (29830 - cycle_counter + 1) + 29828;
+            }
+        }
+        return (std::min)(frame, dmc.cycles_until_irq());
+    }
+
     void write_register(uint16_t address, uint8_t value) {
+        timing_changed = true;
         if (address >= 0x4000 && address <= 0x4003) {
             // Pulse 1
             pulse1.write_register(address - 0x4000, value);
@@ -198,6 +311,11 @@ public:
             // Reset happens after 3 or 4 CPU cycles
             frame_counter_reset_delay = 3;
         }
+
+        if (blip) {
+            // Volume and enable changes show up right away
+            record_output();
+        }
     }
 
     uint8_t read_register(uint16_t address) {
@@ -215,6 +333,7 @@ public:
 
             // Reading clears frame counter IRQ flag
             frame_counter_irq_flag = false;
+            timing_changed = true;
 
             return status;
         }
@@ -547,6 +666,18 @@ private:
             }
         }
 
+        // Same as clock_timer() called clocks times
+        void advance(uint32_t clocks) {
+            if (clocks <= timer_counter) {
+                timer_counter -= clocks;
+                return;
+            }
+            clocks -= timer_counter + 1;
+            uint32_t reloads = 1 + clocks / (timer_period + 1);
+            timer_counter = timer_period - clocks % (timer_period + 1);
+            sequence_position = (sequence_position + reloads) & 7;
+        }
+
         void clock_envelope() {
             if (envelope_start_flag) {
                 envelope_start_flag = false;
@@ -716,6 +847,21 @@ private:
             }
         }
 
+        // Same as clock_timer() called clocks times. The length and linear counters
+        // only change on frame sequencer events, so the gate holds for the whole span.
+        void advance(uint32_t clocks) {
+            if (clocks <= timer_counter) {
+                timer_counter -= clocks;
+                return;
+            }
+            clocks -= timer_counter + 1;
+            uint32_t reloads = 1 + clocks / (timer_period + 1);
+            timer_counter = timer_period - clocks % (timer_period + 1);
+            if (length_counter > 0 && linear_counter > 0) {
+                sequence_position = (sequence_position + reloads) & 31;
+            }
+        }
+
         void clock_linear_counter() {
             if (linear_counter_reload_flag) {
                 linear_counter = linear_counter_reload;
@@ -846,6 +992,16 @@ private:
             }
         }
 
+        // Same as clock_timer() called clocks times. The LFSR has to be shifted once per reload.
+        void advance(uint32_t clocks) {
+            while (clocks > timer_counter) {
+                clocks -= timer_counter + 1;
+                timer_counter = 0;
+                clock_timer();
+            }
+            timer_counter -= clocks;
+        }
+
         void clock_envelope() {
             if (envelope_start_flag) {
                 envelope_start_flag = false;
@@ -997,6 +1153,26 @@ private:
             }
         }
 
+        // Same as clock_timer() called clocks times. Each reload runs the output unit and may fetch a byte.
+        void advance(uint32_t clocks) {
+            while (clocks > timer_counter) {
+                clocks -= timer_counter + 1;
+                timer_counter = 0;
+                clock_timer();
+            }
+            timer_counter -= clocks;
+        }
+
+        // The IRQ can only go up when a byte is fetched, and that only happens
+        // on the reload that empties the shift register.
+        int cycles_until_irq() const {
+            if (!irq_enabled || bytes_remaining == 0) {
+                return INT_MAX;
+            }
+            int reloads = bits_remaining == 0 ? 256 : bits_remaining;
+            return timer_counter + (reloads - 1) * (timer_period + 1);
+        }
+
         void fill_sample_buffer() {
             if (sample_buffer_empty && bytes_remaining > 0) {
                 // Read sample byte from memory
@@ -1124,7 +1300,88 @@ private:
     static const std::array<uint8_t, 4> pulse_duty_table[4];
     static const std::array<uint8_t, 32> triangle_sequence;
 
+    // Pulse mixing (non-linear), pulse_sum 0-30
+    static float mix_pulse(uint8_t pulse_sum) {
+        float pulse_out = 0.0f;
+        if (pulse_sum > 0) {
+            pulse_out = 95.88f / ((8128.0f / pulse_sum) + 100.0f);
+        }
+        return pulse_out;
+    }
+
+    // TND mixing (non-linear), tnd_index 0-202.
+    // The NESdev lookup table approximation of the 8227/12241/22638 weighted sum.
+    static float mix_tnd(uint32_t tnd_sum) {
+        float tnd_out = 0.0f;
+        if (tnd_sum > 0) {
+            tnd_out = 163.67f / ((24329.0f / tnd_sum) + 100.0f);
+        }
+        return tnd_out;
+    }
+
+    static uint32_t tnd_index(uint8_t tr, uint8_t no, uint8_t dm) {
+        return 3 * tr + 2 * no + dm;
+    }
+
+    struct MixerTables {
+        float pulse[31];
+        float tnd_table[203];
+
+        MixerTables() {
+            for (int i = 0; i < 31; i++) {
+                pulse[i] = mix_pulse((uint8_t)i);
+            }
+            for (int i = 0; i < 203; i++) {
+                tnd_table[i] = mix_tnd((uint32_t)i);
+            }
+        }
+    };
+
+    static const MixerTables& mixer_tables() {
+        static const MixerTables tables;
+        return tables;
+    }
+
     // ===== HELPER FUNCTIONS =====
+    // Number of step() calls until the first one where some channel's output could change.
+    // Only timer reloads change the waveform, everything else happens on frame sequencer
+    // events or register writes, which are never inside a span.
+    uint32_t cycles_to_output_change() const {
+        uint32_t change = UINT32_MAX;
+        // Pulse and noise clock on even cycle_counter values, so n clocks take 2n steps
+        uint32_t odd = cycle_counter & 1;
+        if (pulse1.length_counter > 0 && pulse1.timer_period >= 8) {
+            change = (std::min)(change, 2u * pulse1.timer_counter + 1 + odd);
+        }
+        if (pulse2.length_counter > 0 && pulse2.timer_period >= 8) {
+            change = (std::min)(change, 2u * pulse2.timer_counter + 1 + odd);
+        }
+        if (noise.length_counter > 0) {
+            change = (std::min)(change, 2u * noise.timer_counter + 1 + odd);
+        }
+        if (triangle.length_counter > 0 && triangle.linear_counter > 0 && triangle.timer_period >= 2) {
+            change = (std::min)(change, (uint32_t)triangle.timer_counter + 1);
+        }
+        // A silent DMC with nothing buffered stays silent until a register write
+        if (!dmc.silence_flag || !dmc.sample_buffer_empty) {
+            change = (std::min)(change, (uint32_t)dmc.timer_counter + 1);
+        }
+        return change;
+    }
+
+    // Number of step() calls before the one where the frame sequencer switch fires
+    uint32_t cycles_to_frame_event() const {
+        static constexpr uint32_t events_4step[] = { 7457, 14913, 22371, 29828, 29829, 29830 };
+        static constexpr uint32_t events_5step[] = { 7457, 14913, 22371, 29829, 37281, 37282 };
+        const uint32_t* events = frame_counter_mode == 0 ? events_4step : events_5step;
+        for (int i = 0; i < 6; i++) {
+            if (events[i] >= cycle_counter) {
+                return events[i] - cycle_counter;
+            }
+        }
+        return 0;
+    }
+
     void clock_quarter_frame() {
         // Envelopes & triangle linear counter
         pulse1.clock_envelope();
@@ -1144,40 +1401,13 @@ private:
         pulse2.clock_sweep(false);  // Pulse 2 uses two's complement
     }
 
-    // Audio mixing using non-linear formulas to approximate NES hardware
+    // Audio mixing using non-linear formulas to approximate NES hardware.
+    // The formulas only ever see a handful of inputs, so they are evaluated once into tables.
     float mix_output() {
-        // Get channel outputs
-        uint8_t p1 = pulse1.get_output();
-        uint8_t p2 = pulse2.get_output();
-        uint8_t tr = triangle.get_output();
-        uint8_t no = noise.get_output();
-        uint8_t dm = dmc.get_output();
-
-        // Pulse mixing (non-linear) - RETAIN THIS
-        float pulse_out = 0.0f;
-        uint8_t pulse_sum = p1 + p2;
-        if (pulse_sum > 0) {
-            pulse_out = 95.88f / ((8128.0f / pulse_sum) + 100.0f);
-        }
-
-        // TND mixing (non-linear) - CRITICAL FIX HERE
-        float tnd_out = 0.0f;
-
-        // Use the standard NESdev coefficients for TND sum
-        float tr_vol = static_cast<float>(tr) / 8227.0;
-        float no_vol = static_cast<float>(no) / 12241.0;
-        float dm_vol = static_cast<float>(dm) / 22638.0;
-
-        float tnd_sum = tr_vol + no_vol + dm_vol;
-
-        if (tnd_sum > 0) {
-            tnd_out = 159.79f / (1.0f / tnd_sum + 100.0f);
-        }
-
-        // Combine and normalize (your output scaling factor might need adjustment based on final taste)
-        float output = pulse_out + tnd_out;
-
-        return output * 1.3f; // The scaling factor 1.3f is for final volume adjustment
+        const MixerTables& tables = mixer_tables();
+        uint8_t pulse_sum = pulse1.get_output() + pulse2.get_output();
+        uint32_t tnd = tnd_index(triangle.get_output(), noise.get_output(), dmc.get_output());
+        return (tables.pulse[pulse_sum] + tables.tnd_table[tnd]) * 1.3f;
     }
 
     struct PulseChannelState {
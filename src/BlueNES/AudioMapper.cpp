@@ -11,6 +11,7 @@ void AudioMapper::register_memory(Bus& bus) {
 }
 
 uint8_t AudioMapper::read(uint16_t address) {
+	apu.catch_up();
 	return apu.read_register(address);
 }
 
@@ -19,5 +20,6 @@ uint8_t AudioMapper::peek(uint16_t address) {
 }
 
 void AudioMapper::write(uint16_t address, uint8_t value) {
+	apu.catch_up();
 	apu.write_register(address, value);
 }
\ No newline at end of file
@@ -28,13 +28,17 @@ void AxROMMapper::RecomputeChrMappings() {
 
 void AxROMMapper::Serialize(Serializer& serializer) {
 	MapperBase::Serialize(serializer);
+	serializer.BeginChunk(ChunkTag("AxRO"));
 	serializer.Write(nameTable);
 	serializer.Write(prgBankSelect);
+	serializer.EndChunk();
 }
 
 void AxROMMapper::Deserialize(Serializer& serializer) {
 	MapperBase::Deserialize(serializer);
+	serializer.RequireChunk(ChunkTag("AxRO"));
 	serializer.Read(nameTable);
 	serializer.Read(prgBankSelect);
+	serializer.CloseChunk();
 	RecomputeMappings();
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "BlipBuffer.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+	const double PI = 3.14159265358979323846;
+	// Keep a little below Nyquist so the window's transition band doesn't fold back
+	const double CUTOFF = 0.9;
+
+	// Impulse kernels for each sub-sample phase. Each row sums to 1, so a delta integrates
+	// to exactly its own height and the DC level never drifts.
+	struct Kernel {
+		float taps[BlipBuffer::PHASES + 1][BlipBuffer::TAPS];
+
+		Kernel() {
+			const int half = BlipBuffer::TAPS / 2;
+			for (int p = 0; p <= BlipBuffer::PHASES; p++) {
+				double frac = (double)p / BlipBuffer::PHASES;
+				double sum = 0.0;
+				double row[BlipBuffer::TAPS];
+				for (int i = 0; i < BlipBuffer::TAPS; i++) {
+					// Distance from the (delayed) step, in output samples
+					double d = i - frac - half + 1;
+					double x = PI * CUTOFF * d;
+					double sinc = d == 0.0 ? 1.0 : std::sin(x) / x;
+					// Blackman window over [-half, half]
+					double w = 0.42 + 0.5 * std::cos(PI * d / half) + 0.08 * std::cos(2.0 * PI * d / half);
+					row[i] = std::fabs(d) >= half ? 0.0 : sinc * w;
+					sum += row[i];
+				}
+				for (int i = 0; i < BlipBuffer::TAPS; i++) {
+					taps[p][i] = (float)(row[i] / sum);
+				}
+			}
+		}
+	};
+
+	const Kernel& kernel() {
+		static const Kernel k;
+		return k;
+	}
+}
+
+BlipBuffer::BlipBuffer(int maxSamples) {
+	buffer.resize(maxSamples + TAPS);
+	kernel();
+}
+
+void BlipBuffer::SetRates(double clockRate, double sampleRate) {
+	samplesPerClock = sampleRate / clockRate;
+	Clear();
+}
+
+void BlipBuffer::Clear() {
+	std::fill(buffer.begin(), buffer.end(), 0.0f);
+	offset = 0.0;
+	integrator = 0.0f;
+}
+
+uint32_t BlipBuffer::MaxFrameClocks() const {
+	double room = (double)(buffer.size() - TAPS) - offset;
+	return room <= 0.0 ? 0 : (uint32_t)(room / samplesPerClock);
+}
+
+void BlipBuffer::AddDelta(uint32_t time, float delta) {
+	double pos = offset + time * samplesPerClock;
+	size_t whole = (size_t)pos;
+	if (whole + TAPS > buffer.size()) {
+		// Frame ran longer than the buffer, drop it rather than write past the end
+		return;
+	}
+	int phase = (int)((pos - whole) * PHASES + 0.5);
+	const float* k = kernel().taps[phase];
+	float* out = &buffer[whole];
+	for (int i = 0; i < TAPS; i++) {
+		out[i] += delta * k[i];
+	}
+}
+
+void BlipBuffer::EndFrame(uint32_t clocks) {
+	offset += clocks * samplesPerClock;
+	double limit = (double)(buffer.size() - TAPS);
+	if (offset > limit) {
+		offset = limit;
+	}
+}
+
+/// <summary>
+/// Integrates up to count samples into out and shifts the rest of the buffer down.
+/// Returns how many samples were written.
+/// </summary>
+int BlipBuffer::ReadSamples(float* out, int count) {
+	count = (std::min)(count, SamplesAvailable());
+	if (count <= 0) {
+		return 0;
+	}
+	float sum = integrator;
+	for (int i = 0; i < count; i++) {
+		sum += buffer[i];
+		out[i] = sum;
+	}
+	integrator = sum;
+
+	// Deltas that are still being spread into the samples after these
+	size_t remaining = (size_t)SamplesAvailable() - count + TAPS;
+	std::memmove(buffer.data(), buffer.data() + count, remaining * sizeof(float));
+	std::fill(buffer.begin() + remaining, buffer.begin() + remaining + count, 0.0f);
+	offset -= count;
+	return count;
+}
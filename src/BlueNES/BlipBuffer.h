@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Band-limited step synthesis. The APU reports every change of its mixed output as a delta
+// at the CPU cycle it happened on, each delta is spread over a few output samples with a windowed
+// sinc, and reading integrates them back into a signal. Nothing is done on cycles where the
+// output doesn't change, and the output rate can be anything.
+class BlipBuffer {
+public:
+	// maxSamples is the most output samples a frame can hold before it has to be read out
+	BlipBuffer(int maxSamples);
+
+	void SetRates(double clockRate, double sampleRate);
+	void Clear();
+
+	// time is in clocks since the last EndFrame()
+	void AddDelta(uint32_t time, float delta);
+	// Makes everything before clocks readable, and starts the next frame at clocks
+	void EndFrame(uint32_t clocks);
+
+	int SamplesAvailable() const { return (int)offset; }
+	int ReadSamples(float* out, int count);
+
+	// How many clocks a frame can run before the buffer is full
+	uint32_t MaxFrameClocks() const;
+
+	// Kernel resolution. Deltas are placed to within 1/PHASES of a sample.
+	static constexpr int PHASES = 32;
+	static constexpr int TAPS = 16;
+
+private:
+	std::vector<float> buffer;
+	double samplesPerClock = 0.0;
+	// Output position of clock 0 of the current frame. The whole part is ready to read.
+	double offset = 0.0;
+	float integrator = 0.0f;
+};
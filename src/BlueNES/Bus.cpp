@@ -7,6 +7,7 @@
 #include "MemoryMapper.h"
 #include "OpenBusMapper.h"
 #include "Serializer.h"
+#include "Nes.h"
 #include <time.h>
 
 Bus::Bus(CPU& cpu, PPU& ppu, APU& apu, Input& input, Cartridge& cart, OpenBusMapper& openBus)
@@ -18,6 +19,10 @@ Bus::Bus(CPU& cpu, PPU& ppu, APU& apu, Input& input, Cartridge& cart, OpenBusMap
 		readMemoryMap[i] = &openBus;
 		writeMemoryMap[i] = &openBus;
 	}
+	for (int i = 0; i < 0x100; i++) {
+		readPages[i] = nullptr;
+		writePages[i] = nullptr;
+	}
 	srand((unsigned)time(NULL));
 }
 
@@ -38,36 +43,91 @@ void Bus::PowerCycle() {
 	ramMapper.cpuRAM.fill(0xFF);
 }
 
+// Registering a handler takes the page out of the fast path. Whoever owns the memory
+// behind it can map it back in with MapPages.
 void Bus::ReadRegisterAdd(uint16_t start, uint16_t end, MemoryMapper* mapper) {
 	for (uint32_t addr = start; addr <= end; addr++) {
 		readMemoryMap[addr] = mapper;
+		readPages[addr >> 8] = nullptr;
 	}
 }
 
 void Bus::WriteRegisterAdd(uint16_t start, uint16_t end, MemoryMapper* mapper) {
     for (uint32_t addr = start; addr <= end; addr++) {
         writeMemoryMap[addr] = mapper;
+        writePages[addr >> 8] = nullptr;
     }
 }
 
+/// <summary>
+/// Points the pages in [start, end] straight at source. The source is repeated
+/// every size bytes, which takes care of mirroring (2KB RAM across $0000-$1FFF).
+/// start and size must be multiples of 256.
+/// </summary>
+void Bus::MapPages(uint16_t start, uint16_t end, uint8_t* source, size_t size, bool writable) {
+	uint8_t startPage = start >> 8;
+	uint8_t endPage = end >> 8;
+	for (int i = startPage; i <= endPage; i++) {
+		uint8_t* page = &source[((size_t)(i - startPage) * 256) % size];
+		readPages[i] = page;
+		writePages[i] = writable ? page : nullptr;
+	}
+}
+
+void Bus::UnmapPages(uint16_t start, uint16_t end) {
+	uint8_t startPage = start >> 8;
+	uint8_t endPage = end >> 8;
+	for (int i = startPage; i <= endPage; i++) {
+		readPages[i] = nullptr;
+		writePages[i] = nullptr;
+	}
+}
+
 void Bus::initialize() {
 	// Initialize CPU RAM mapping
 	ReadRegisterAdd(0x0000, 0x1FFF, (MemoryMapper*)&ramMapper);
 	WriteRegisterAdd(0x0000, 0x1FFF, (MemoryMapper*)&ramMapper);
+	MapPages(0x0000, 0x1FFF, ramMapper.cpuRAM.data(), ramMapper.cpuRAM.size(), true);
 }
 
 uint8_t Bus::read(uint16_t addr) {
-	uint8_t val = readMemoryMap[addr]->read(addr);
+	uint8_t* page = readPages[addr >> 8];
+	uint8_t val;
+	if (page) {
+		val = page[addr & 0xFF];
+	}
+	else {
+		if (stepSync) {
+			stepSync->syncDevices();
+		}
+		if ((addr & 0xE007) == 0x2002) {
+			idleStatusRead = true;
+		}
+		else {
+			idleSideEffect = true;
+		}
+		val = readMemoryMap[addr]->read(addr);
+	}
 	openBus.setOpenBus(val);
 	return val;
 }
 
 uint8_t Bus::peek(uint16_t addr) {
-	return readMemoryMap[addr]->peek(addr);
+	uint8_t* page = readPages[addr >> 8];
+	return page ? page[addr & 0xFF] : readMemoryMap[addr]->peek(addr);
 }
 
 void Bus::write(uint16_t addr, uint8_t data) {
 	openBus.setOpenBus(data);
+	idleSideEffect = true;
+	uint8_t* page = writePages[addr >> 8];
+	if (page) {
+		page[addr & 0xFF] = data;
+		return;
+	}
+	if (stepSync) {
+		stepSync->syncDevices();
+	}
 	writeMemoryMap[addr]->write(addr, data);
 }
 
@@ -12,6 +12,7 @@ class APU;
 class Input;
 class OpenBusMapper;
 class Serializer;
+class Nes;
 
 class Bus
 {
@@ -25,9 +26,26 @@ public:
 	MemoryMapper** readMemoryMap; // 64KB memory map
 	MemoryMapper** writeMemoryMap; // 64KB memory map
 
+	// Fast path for plain memory (RAM, PRG-RAM, PRG-ROM). One pointer per 256 byte page.
+	// A null entry means the page has side effects (PPU, APU, mapper registers, etc.)
+	// and has to go through the memory map above.
+	uint8_t* readPages[0x100];
+	uint8_t* writePages[0x100];
+
+	// Set while the Nes runs instruction-stepped. Anything that misses the page table
+	// syncs the PPU/APU to the current CPU cycle before the access happens.
+	Nes* stepSync = nullptr;
+
+	// Idle loop detection. Cleared by the Nes at the top of a loop iteration.
+	// Any write or register read other than PPUSTATUS counts as a side effect.
+	bool idleSideEffect = false;
+	bool idleStatusRead = false;
+
 	// Access functions
 	void ReadRegisterAdd(uint16_t start, uint16_t end, MemoryMapper* mapper);
 	void WriteRegisterAdd(uint16_t start, uint16_t end, MemoryMapper* mapper);
+	void MapPages(uint16_t start, uint16_t end, uint8_t* source, size_t size, bool writable);
+	void UnmapPages(uint16_t start, uint16_t end);
 	uint8_t read(uint16_t addr);
 	uint8_t peek(uint16_t addr);
 	void write(uint16_t addr, uint8_t data);
@@ -23,11 +23,15 @@ void CNROM::writeRegister(uint16_t addr, uint8_t val, uint64_t currentCycle) {
 
 void CNROM::Serialize(Serializer& serializer) {
 	MapperBase::Serialize(serializer);
+	serializer.BeginChunk(ChunkTag("CNRO"));
 	serializer.Write(_chrBankReg);
+	serializer.EndChunk();
 }
 
 void CNROM::Deserialize(Serializer& serializer) {
 	MapperBase::Deserialize(serializer);
+	serializer.RequireChunk(ChunkTag("CNRO"));
 	serializer.Read(_chrBankReg);
+	serializer.CloseChunk();
 	RecomputeMappings();
 }
\ No newline at end of file
@@ -32,6 +32,7 @@ bool CPU::ShouldPause() {
 		// Notify the Debugger UI thread
 		//PostMessage(dbgCtx.hwndDbg, WM_USER_BREAKPOINT_HIT, 0, 0);
 		dbgCtx.hit_breakpoint.store(true);
+		ppu.CatchUp();
 		ppu.UpdateState();
 	}
 
@@ -61,10 +62,30 @@ bool CPU::ShouldPause() {
 /// Although some are dummy reads/writes, they must happen to keep the timing correct.
 /// </summary>
 void CPU::cpu_tick() {
+#ifdef CPU_NO_DEBUGGER
+	tick<NoDebug>();
+#else
+	if (debuggerAttached) {
+		tick<WithDebug>();
+	}
+	else {
+		tick<NoDebug>();
+	}
+#endif
+}
+
+/// <summary>
+/// The actual tick. The debugger hooks (breakpoints, fetch logging, lastState) only exist
+/// in the WithDebug variant, so nobody pays for them unless a debugger window is open.
+/// </summary>
+template<typename DebugPolicy>
+void CPU::tick() {
 	if (!isActive) return;
 	if (inst_complete) {
-		while (ShouldPause() && sharedCtx.is_running) {
-			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		if constexpr (DebugPolicy::enabled) {
+			while (ShouldPause() && sharedCtx.is_running) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
 		}
 		// Priority 1: reset
 		if (reset_line) {
@@ -88,13 +109,15 @@ void CPU::cpu_tick() {
 		// Priority 3: Normal Fetch
 		else {
 			// This is the actual T0 Read.
-			dbgCtx.LogInstructionFetch(m_pc);
-			dbgCtx.lastState.a = m_a;
-			dbgCtx.lastState.x = m_x;
-			dbgCtx.lastState.y = m_y;
-			dbgCtx.lastState.sp = m_sp;
-			dbgCtx.lastState.p = m_p;
-			dbgCtx.lastState.pc = m_pc; // Pointing to the opcode just executed/fetched
+			if constexpr (DebugPolicy::enabled) {
+				dbgCtx.LogInstructionFetch(m_pc);
+				dbgCtx.lastState.a = m_a;
+				dbgCtx.lastState.x = m_x;
+				dbgCtx.lastState.y = m_y;
+				dbgCtx.lastState.sp = m_sp;
+				dbgCtx.lastState.p = m_p;
+				dbgCtx.lastState.pc = m_pc; // Pointing to the opcode just executed/fetched
+			}
 			current_opcode = ReadByte(m_pc++);
 		}
 		cycle_state = 1;
@@ -102,7 +125,12 @@ void CPU::cpu_tick() {
 	}
 	else {
 		// Execute the micro-op for the current instruction
-		opcode_table[current_opcode](*this);
+		if (flatDispatch) {
+			step_table[current_opcode][(addr_complete ? OP_STEP_BASE : 0) + cycle_state](*this);
+		}
+		else {
+			opcode_table[current_opcode](*this);
+		}
 	}
 
 	//"This edge detector polls the status of the NMI line during o2 of each CPU cycle (i.e., during the 
@@ -145,7 +173,7 @@ void CPU::Serialize(Serializer& serializer) {
 	cpu.current_opcode = current_opcode;
 
 	cpu.addr_low = addr_low;
-	cpu.addr_high = cpu.addr_high;
+	cpu.addr_high = addr_high;
 	cpu.m_temp_low = m_temp_low;
 	cpu.effective_addr = effective_addr;
 	cpu.offset = offset;
@@ -469,202 +497,202 @@ void CPU::init_cpu() {
 	reset_line = false;
 	// Halt on invalid instructions.
 	for (int i = 0; i < 0x100; i++) {
-		opcode_table[i] = &run_standalone_instruction<Op_HLT>;
+		map_standalone_instruction<Op_HLT>(i);
 	}
 
-	opcode_table[0x06] = &run_instruction<Mode_ZeroPage, Op_RMW<Logic_ASL>>;
-	opcode_table[0x0A] = &run_accumulator_instruction<Op_ASL>;
-	opcode_table[0x0E] = &run_instruction<Mode_Absolute, Op_RMW<Logic_ASL>>;
-	opcode_table[0x16] = &run_instruction<Mode_ZeroPageX, Op_RMW<Logic_ASL>>;
-	opcode_table[0x1E] = &run_instruction<Mode_AbsoluteX<Op_ASL::is_rmw>, Op_RMW<Logic_ASL>>;
-
-	opcode_table[0x21] = &run_instruction<Mode_IndirectX, Op_AND>;
-	opcode_table[0x25] = &run_instruction<Mode_ZeroPage, Op_AND>;
-	opcode_table[0x29] = &run_instruction<Mode_Immediate, Op_AND>;
-	opcode_table[0x2D] = &run_instruction<Mode_Absolute, Op_AND>;
-	opcode_table[0x31] = &run_instruction<Mode_IndirectY<Op_AND::is_rmw>, Op_AND>;
-	opcode_table[0x35] = &run_instruction<Mode_ZeroPageX, Op_AND>;
-	opcode_table[0x39] = &run_instruction<Mode_AbsoluteY<Op_AND::is_rmw>, Op_AND>;
-	opcode_table[0x3D] = &run_instruction<Mode_AbsoluteX<Op_AND::is_rmw>, Op_AND>;
-
-	opcode_table[0x61] = &run_instruction<Mode_IndirectX, Op_ADC>;
-	opcode_table[0x65] = &run_instruction<Mode_ZeroPage, Op_ADC>;
-	opcode_table[0x69] = &run_instruction<Mode_Immediate, Op_ADC>;
-	opcode_table[0x6D] = &run_instruction<Mode_Absolute, Op_ADC>;
-	opcode_table[0x71] = &run_instruction<Mode_IndirectY<Op_ADC::is_rmw>, Op_ADC>;
-	opcode_table[0x75] = &run_instruction<Mode_ZeroPageX, Op_ADC>;
-	opcode_table[0x79] = &run_instruction<Mode_AbsoluteY<Op_ADC::is_rmw>, Op_ADC>;
-	opcode_table[0x7D] = &run_instruction<Mode_AbsoluteX<Op_ADC::is_rmw>, Op_ADC>;
-
-	opcode_table[0x90] = &run_standalone_instruction<Op_BCC>;
-	opcode_table[0xB0] = &run_standalone_instruction<Op_BCS>;
-	opcode_table[0xF0] = &run_standalone_instruction<Op_BEQ>;
-	opcode_table[0x30] = &run_standalone_instruction<Op_BMI>;
-	opcode_table[0xD0] = &run_standalone_instruction<Op_BNE>;
-	opcode_table[0x10] = &run_standalone_instruction<Op_BPL>;
-	opcode_table[0x50] = &run_standalone_instruction<Op_BVC>;
-	opcode_table[0x70] = &run_standalone_instruction<Op_BVS>;
-
-	opcode_table[0x00] = &run_standalone_instruction<Op_BRK>;
-
-	opcode_table[0x24] = &run_instruction<Mode_ZeroPage, Op_BIT>;
-	opcode_table[0x2C] = &run_instruction<Mode_Absolute, Op_BIT>;
-
-	opcode_table[0x18] = &run_instruction<Mode_Implied, Op_CLC>;
-	opcode_table[0xD8] = &run_instruction<Mode_Implied, Op_CLD>;
-	opcode_table[0x58] = &run_instruction<Mode_Implied, Op_CLI>;
-	opcode_table[0xB8] = &run_instruction<Mode_Implied, Op_CLV>;
-
-	opcode_table[0xC9] = &run_instruction<Mode_Immediate, Op_CMP>;
-	opcode_table[0xC5] = &run_instruction<Mode_ZeroPage, Op_CMP>;
-	opcode_table[0xD5] = &run_instruction<Mode_ZeroPageX, Op_CMP>;
-	opcode_table[0xCD] = &run_instruction<Mode_Absolute, Op_CMP>;
-	opcode_table[0xDD] = &run_instruction<Mode_AbsoluteX<Op_CMP::is_rmw>, Op_CMP>;
-	opcode_table[0xD9] = &run_instruction<Mode_AbsoluteY<Op_CMP::is_rmw>, Op_CMP>;
-	opcode_table[0xC1] = &run_instruction<Mode_IndirectX, Op_CMP>;
-	opcode_table[0xD1] = &run_instruction<Mode_IndirectY<Op_CMP::is_rmw>, Op_CMP>;
-
-	opcode_table[0xE0] = &run_instruction<Mode_Immediate, Op_CPX>;
-	opcode_table[0xE4] = &run_instruction<Mode_ZeroPage, Op_CPX>;
-	opcode_table[0xEC] = &run_instruction<Mode_Absolute, Op_CPX>;
-
-	opcode_table[0xC0] = &run_instruction<Mode_Immediate, Op_CPY>;
-	opcode_table[0xC4] = &run_instruction<Mode_ZeroPage, Op_CPY>;
-	opcode_table[0xCC] = &run_instruction<Mode_Absolute, Op_CPY>;
-
-	opcode_table[0xC6] = &run_instruction<Mode_ZeroPage, Op_RMW<Logic_DEC>>;
-	opcode_table[0xD6] = &run_instruction<Mode_ZeroPageX, Op_RMW<Logic_DEC>>;
-	opcode_table[0xCE] = &run_instruction<Mode_Absolute, Op_RMW<Logic_DEC>>;
-	opcode_table[0xDE] = &run_instruction<Mode_AbsoluteX<true>, Op_RMW<Logic_DEC>>;
-
-	opcode_table[0xCA] = &run_instruction<Mode_Implied, Op_DEX>;
-	opcode_table[0x88] = &run_instruction<Mode_Implied, Op_DEY>;
-
-	opcode_table[0x49] = &run_instruction<Mode_Immediate, Op_EOR>;
-	opcode_table[0x45] = &run_instruction<Mode_ZeroPage, Op_EOR>;
-	opcode_table[0x55] = &run_instruction<Mode_ZeroPageX, Op_EOR>;
-	opcode_table[0x4D] = &run_instruction<Mode_Absolute, Op_EOR>;
-	opcode_table[0x5D] = &run_instruction<Mode_AbsoluteX<Op_EOR::is_write>, Op_EOR>;
-	opcode_table[0x59] = &run_instruction<Mode_AbsoluteY<Op_EOR::is_write>, Op_EOR>;
-	opcode_table[0x41] = &run_instruction<Mode_IndirectX, Op_EOR>;
-	opcode_table[0x51] = &run_instruction<Mode_IndirectY<Op_EOR::is_write>, Op_EOR>;
-
-	opcode_table[0xE6] = &run_instruction<Mode_ZeroPage, Op_RMW<Logic_INC>>;
-	opcode_table[0xF6] = &run_instruction<Mode_ZeroPageX, Op_RMW<Logic_INC>>;
-	opcode_table[0xEE] = &run_instruction<Mode_Absolute, Op_RMW<Logic_INC>>;
+	map_instruction<Mode_ZeroPage, Op_RMW<Logic_ASL>>(0x06);
+	map_accumulator_instruction<Op_ASL>(0x0A);
+	map_instruction<Mode_Absolute, Op_RMW<Logic_ASL>>(0x0E);
+	map_instruction<Mode_ZeroPageX, Op_RMW<Logic_ASL>>(0x16);
+	map_instruction<Mode_AbsoluteX<Op_ASL::is_rmw>, Op_RMW<Logic_ASL>>(0x1E);
+
+	map_instruction<Mode_IndirectX, Op_AND>(0x21);
+	map_instruction<Mode_ZeroPage, Op_AND>(0x25);
+	map_instruction<Mode_Immediate, Op_AND>(0x29);
+	map_instruction<Mode_Absolute, Op_AND>(0x2D);
+	map_instruction<Mode_IndirectY<Op_AND::is_rmw>, Op_AND>(0x31);
+	map_instruction<Mode_ZeroPageX, Op_AND>(0x35);
+	map_instruction<Mode_AbsoluteY<Op_AND::is_rmw>, Op_AND>(0x39);
+	map_instruction<Mode_AbsoluteX<Op_AND::is_rmw>, Op_AND>(0x3D);
+
+	map_instruction<Mode_IndirectX, Op_ADC>(0x61);
+	map_instruction<Mode_ZeroPage, Op_ADC>(0x65);
+	map_instruction<Mode_Immediate, Op_ADC>(0x69);
+	map_instruction<Mode_Absolute, Op_ADC>(0x6D);
+	map_instruction<Mode_IndirectY<Op_ADC::is_rmw>, Op_ADC>(0x71);
+	map_instruction<Mode_ZeroPageX, Op_ADC>(0x75);
+	map_instruction<Mode_AbsoluteY<Op_ADC::is_rmw>, Op_ADC>(0x79);
+	map_instruction<Mode_AbsoluteX<Op_ADC::is_rmw>, Op_ADC>(0x7D);
+
+	map_standalone_instruction<Op_BCC>(0x90);
+	map_standalone_instruction<Op_BCS>(0xB0);
+	map_standalone_instruction<Op_BEQ>(0xF0);
+	map_standalone_instruction<Op_BMI>(0x30);
+	map_standalone_instruction<Op_BNE>(0xD0);
+	map_standalone_instruction<Op_BPL>(0x10);
+	map_standalone_instruction<Op_BVC>(0x50);
+	map_standalone_instruction<Op_BVS>(0x70);
+
+	map_standalone_instruction<Op_BRK>(0x00);
+
+	map_instruction<Mode_ZeroPage, Op_BIT>(0x24);
+	map_instruction<Mode_Absolute, Op_BIT>(0x2C);
+
+	map_instruction<Mode_Implied, Op_CLC>(0x18);
+	map_instruction<Mode_Implied, Op_CLD>(0xD8);
+	map_instruction<Mode_Implied, Op_CLI>(0x58);
+	map_instruction<Mode_Implied, Op_CLV>(0xB8);
+
+	map_instruction<Mode_Immediate, Op_CMP>(0xC9);
+	map_instruction<Mode_ZeroPage, Op_CMP>(0xC5);
+	map_instruction<Mode_ZeroPageX, Op_CMP>(0xD5);
+	map_instruction<Mode_Absolute, Op_CMP>(0xCD);
+	map_instruction<Mode_AbsoluteX<Op_CMP::is_rmw>, Op_CMP>(0xDD);
+	map_instruction<Mode_AbsoluteY<Op_CMP::is_rmw>, Op_CMP>(0xD9);
+	map_instruction<Mode_IndirectX, Op_CMP>(0xC1);
+	map_instruction<Mode_IndirectY<Op_CMP::is_rmw>, Op_CMP>(0xD1);
+
+	map_instruction<Mode_Immediate, Op_CPX>(0xE0);
+	map_instruction<Mode_ZeroPage, Op_CPX>(0xE4);
+	map_instruction<Mode_Absolute, Op_CPX>(0xEC);
+
+	map_instruction<Mode_Immediate, Op_CPY>(0xC0);
+	map_instruction<Mode_ZeroPage, Op_CPY>(0xC4);
+	map_instruction<Mode_Absolute, Op_CPY>(0xCC);
+
+	map_instruction<Mode_ZeroPage, Op_RMW<Logic_DEC>>(0xC6);
+	map_instruction<Mode_ZeroPageX, Op_RMW<Logic_DEC>>(0xD6);
+	map_instruction<Mode_Absolute, Op_RMW<Logic_DEC>>(0xCE);
+	map_instruction<Mode_AbsoluteX<true>, Op_RMW<Logic_DEC>>(0xDE);
+
+	map_instruction<Mode_Implied, Op_DEX>(0xCA);
+	map_instruction<Mode_Implied, Op_DEY>(0x88);
+
+	map_instruction<Mode_Immediate, Op_EOR>(0x49);
+	map_instruction<Mode_ZeroPage, Op_EOR>(0x45);
+	map_instruction<Mode_ZeroPageX, Op_EOR>(0x55);
+	map_instruction<Mode_Absolute, Op_EOR>(0x4D);
+	map_instruction<Mode_AbsoluteX<Op_EOR::is_write>, Op_EOR>(0x5D);
+	map_instruction<Mode_AbsoluteY<Op_EOR::is_write>, Op_EOR>(0x59);
+	map_instruction<Mode_IndirectX, Op_EOR>(0x41);
+	map_instruction<Mode_IndirectY<Op_EOR::is_write>, Op_EOR>(0x51);
+
+	map_instruction<Mode_ZeroPage, Op_RMW<Logic_INC>>(0xE6);
+	map_instruction<Mode_ZeroPageX, Op_RMW<Logic_INC>>(0xF6);
+	map_instruction<Mode_Absolute, Op_RMW<Logic_INC>>(0xEE);
 	// $FE: INC Absolute, X
 	// Uses "is_rmw=true" -> Forces 7 cycles (Mode T1-T3, Op T4-T6)
-	opcode_table[0xFE] = &run_instruction<Mode_AbsoluteX<true>, Op_RMW<Logic_INC>>;
-	opcode_table[0xE8] = &run_instruction<Mode_Implied, Op_INX>;
-	opcode_table[0xC8] = &run_instruction<Mode_Implied, Op_INY>;
-
-	opcode_table[0x4C] = &run_standalone_instruction<Op_JMP_Absolute>;
-	opcode_table[0x6C] = &run_standalone_instruction<Op_JMP_Indirect>;
-
-	opcode_table[0x20] = &run_standalone_instruction<Op_JSR>;
-
-	opcode_table[0xA9] = &run_instruction<Mode_Immediate, Op_LDA>;
-	opcode_table[0xA5] = &run_instruction<Mode_ZeroPage, Op_LDA>;
-	opcode_table[0xB5] = &run_instruction<Mode_ZeroPageX, Op_LDA>;
-	opcode_table[0xAD] = &run_instruction<Mode_Absolute, Op_LDA>;
-	opcode_table[0xBD] = &run_instruction<Mode_AbsoluteX<Op_LDA::is_rmw>, Op_LDA>;
-	opcode_table[0xB9] = &run_instruction<Mode_AbsoluteY<Op_LDA::is_rmw>, Op_LDA>;
-	opcode_table[0xA1] = &run_instruction<Mode_IndirectX, Op_LDA>;
-	opcode_table[0xB1] = &run_instruction<Mode_IndirectY<Op_LDA::is_rmw>, Op_LDA>;
-
-	opcode_table[0xA2] = &run_instruction<Mode_Immediate, Op_LDX>;
-	opcode_table[0xA6] = &run_instruction<Mode_ZeroPage, Op_LDX>;
-	opcode_table[0xB6] = &run_instruction<Mode_ZeroPageY, Op_LDX>;
-	opcode_table[0xAE] = &run_instruction<Mode_Absolute, Op_LDX>;
-	opcode_table[0xBE] = &run_instruction<Mode_AbsoluteY<Op_LDX::is_rmw>, Op_LDX>;
-
-	opcode_table[0xA0] = &run_instruction<Mode_Immediate, Op_LDY>;
-	opcode_table[0xA4] = &run_instruction<Mode_ZeroPage, Op_LDY>;
-	opcode_table[0xB4] = &run_instruction<Mode_ZeroPageX, Op_LDY>;
-	opcode_table[0xAC] = &run_instruction<Mode_Absolute, Op_LDY>;
-	opcode_table[0xBC] = &run_instruction<Mode_AbsoluteX<Op_LDY::is_rmw>, Op_LDY>;
-
-	opcode_table[0x4A] = &run_instruction<Mode_Implied, Op_LSR_Accumulator>;
-	opcode_table[0x46] = &run_instruction<Mode_ZeroPage, Op_RMW<Logic_LSR>>;
-	opcode_table[0x56] = &run_instruction<Mode_ZeroPageX, Op_RMW<Logic_LSR>>;
-	opcode_table[0x4E] = &run_instruction<Mode_Absolute, Op_RMW<Logic_LSR>>;
-	opcode_table[0x5E] = &run_instruction<Mode_AbsoluteX<true>, Op_RMW<Logic_LSR>>;
-
-	opcode_table[0xEA] = &run_instruction<Mode_Implied, Op_NOP>;
-
-	opcode_table[0x09] = &run_instruction<Mode_Immediate, Op_ORA>;
-	opcode_table[0x05] = &run_instruction<Mode_ZeroPage, Op_ORA>;
-	opcode_table[0x15] = &run_instruction<Mode_ZeroPageX, Op_ORA>;
-	opcode_table[0x0D] = &run_instruction<Mode_Absolute, Op_ORA>;
-	opcode_table[0x1D] = &run_instruction<Mode_AbsoluteX<Op_ORA::is_rmw>, Op_ORA>;
-	opcode_table[0x19] = &run_instruction<Mode_AbsoluteY<Op_ORA::is_rmw>, Op_ORA>;
-	opcode_table[0x01] = &run_instruction<Mode_IndirectX, Op_ORA>;
-	opcode_table[0x11] = &run_instruction<Mode_IndirectY<Op_ORA::is_rmw>, Op_ORA>;
-
-	opcode_table[0x48] = &run_standalone_instruction<Op_PHA>;
-	opcode_table[0x08] = &run_standalone_instruction<Op_PHP>;
-	opcode_table[0x68] = &run_standalone_instruction<Op_PLA>;
-	opcode_table[0x28] = &run_standalone_instruction<Op_PLP>;
-
-	opcode_table[0x2A] = &run_instruction<Mode_Implied, Op_ROL_Accumulator>;
-	opcode_table[0x26] = &run_instruction<Mode_ZeroPage, Op_RMW<Logic_ROL>>;
-	opcode_table[0x36] = &run_instruction<Mode_ZeroPageX, Op_RMW<Logic_ROL>>;
-	opcode_table[0x2E] = &run_instruction<Mode_Absolute, Op_RMW<Logic_ROL>>;
-	opcode_table[0x3E] = &run_instruction<Mode_AbsoluteX<true>, Op_RMW<Logic_ROL>>;
-
-	opcode_table[0x6A] = &run_instruction<Mode_Implied, Op_ROR_Accumulator>;
-	opcode_table[0x66] = &run_instruction<Mode_ZeroPage, Op_RMW<Logic_ROR>>;
-	opcode_table[0x76] = &run_instruction<Mode_ZeroPageX, Op_RMW<Logic_ROR>>;
-	opcode_table[0x6E] = &run_instruction<Mode_Absolute, Op_RMW<Logic_ROR>>;
-	opcode_table[0x7E] = &run_instruction<Mode_AbsoluteX<true>, Op_RMW<Logic_ROR>>;
-
-
-	opcode_table[0x40] = &run_standalone_instruction<Op_RTI>;
-	opcode_table[0x60] = &run_standalone_instruction<Op_RTS>;
-
-	opcode_table[0xE1] = &run_instruction<Mode_IndirectX, Op_SBC>;
-	opcode_table[0xE5] = &run_instruction<Mode_ZeroPage, Op_SBC>;
-	opcode_table[0xE9] = &run_instruction<Mode_Immediate, Op_SBC>;
-	opcode_table[0xED] = &run_instruction<Mode_Absolute, Op_SBC>;
-	opcode_table[0xF1] = &run_instruction<Mode_IndirectY<Op_SBC::is_rmw>, Op_SBC>;
-	opcode_table[0xF5] = &run_instruction<Mode_ZeroPageX, Op_SBC>;
-	opcode_table[0xF9] = &run_instruction<Mode_AbsoluteY<Op_SBC::is_rmw>, Op_SBC>;
-	opcode_table[0xFD] = &run_instruction<Mode_AbsoluteX<Op_SBC::is_rmw>, Op_SBC>;
-
-	opcode_table[0x38] = &run_instruction<Mode_Implied, Op_SEC>;
-	opcode_table[0xF8] = &run_instruction<Mode_Implied, Op_SED>;
-	opcode_table[0x78] = &run_instruction<Mode_Implied, Op_SEI>;
-
-	opcode_table[0x81] = &run_instruction<Mode_IndirectX, Op_STA>;
-	opcode_table[0x85] = &run_instruction<Mode_ZeroPage, Op_STA>;
-	opcode_table[0x8D] = &run_instruction<Mode_Absolute, Op_STA>;
-	opcode_table[0x91] = &run_instruction<Mode_IndirectY<Op_STA::is_rmw>, Op_STA>;
-	opcode_table[0x95] = &run_instruction<Mode_ZeroPageX, Op_STA>;
-	opcode_table[0x99] = &run_instruction<Mode_AbsoluteY<Op_STA::is_rmw>, Op_STA>;
-	opcode_table[0x9D] = &run_instruction<Mode_AbsoluteX<Op_STA::is_rmw>, Op_STA>;
-
-	opcode_table[0x86] = &run_instruction<Mode_ZeroPage, Op_STX>;
-	opcode_table[0x96] = &run_instruction<Mode_ZeroPageY, Op_STX>;
-	opcode_table[0x8E] = &run_instruction<Mode_Absolute, Op_STX>;
-
-	opcode_table[0x84] = &run_instruction<Mode_ZeroPage, Op_STY>;
-	opcode_table[0x94] = &run_instruction<Mode_ZeroPageX, Op_STY>;
-	opcode_table[0x8C] = &run_instruction<Mode_Absolute, Op_STY>;
-
-	opcode_table[0xAA] = &run_instruction<Mode_Implied, Op_TAX>;
-	opcode_table[0xA8] = &run_instruction<Mode_Implied, Op_TAY>;
-	opcode_table[0xBA] = &run_instruction<Mode_Implied, Op_TSX>;
-	opcode_table[0x8A] = &run_instruction<Mode_Implied, Op_TXA>;
-	opcode_table[0x9A] = &run_instruction<Mode_Implied, Op_TXS>;
-	opcode_table[0x98] = &run_instruction<Mode_Implied, Op_TYA>;
+	map_instruction<Mode_AbsoluteX<true>, Op_RMW<Logic_INC>>(0xFE);
+	map_instruction<Mode_Implied, Op_INX>(0xE8);
+	map_instruction<Mode_Implied, Op_INY>(0xC8);
+
+	map_standalone_instruction<Op_JMP_Absolute>(0x4C);
+	map_standalone_instruction<Op_JMP_Indirect>(0x6C);
+
+	map_standalone_instruction<Op_JSR>(0x20);
+
+	map_instruction<Mode_Immediate, Op_LDA>(0xA9);
+	map_instruction<Mode_ZeroPage, Op_LDA>(0xA5);
+	map_instruction<Mode_ZeroPageX, Op_LDA>(0xB5);
+	map_instruction<Mode_Absolute, Op_LDA>(0xAD);
+	map_instruction<Mode_AbsoluteX<Op_LDA::is_rmw>, Op_LDA>(0xBD);
+	map_instruction<Mode_AbsoluteY<Op_LDA::is_rmw>, Op_LDA>(0xB9);
+	map_instruction<Mode_IndirectX, Op_LDA>(0xA1);
+	map_instruction<Mode_IndirectY<Op_LDA::is_rmw>, Op_LDA>(0xB1);
+
+	map_instruction<Mode_Immediate, Op_LDX>(0xA2);
+	map_instruction<Mode_ZeroPage, Op_LDX>(0xA6);
+	map_instruction<Mode_ZeroPageY, Op_LDX>(0xB6);
+	map_instruction<Mode_Absolute, Op_LDX>(0xAE);
+	map_instruction<Mode_AbsoluteY<Op_LDX::is_rmw>, Op_LDX>(0xBE);
+
+	map_instruction<Mode_Immediate, Op_LDY>(0xA0);
+	map_instruction<Mode_ZeroPage, Op_LDY>(0xA4);
+	map_instruction<Mode_ZeroPageX, Op_LDY>(0xB4);
+	map_instruction<Mode_Absolute, Op_LDY>(0xAC);
+	map_instruction<Mode_AbsoluteX<Op_LDY::is_rmw>, Op_LDY>(0xBC);
+
+	map_instruction<Mode_Implied, Op_LSR_Accumulator>(0x4A);
+	map_instruction<Mode_ZeroPage, Op_RMW<Logic_LSR>>(0x46);
+	map_instruction<Mode_ZeroPageX, Op_RMW<Logic_LSR>>(0x56);
+	map_instruction<Mode_Absolute, Op_RMW<Logic_LSR>>(0x4E);
+	map_instruction<Mode_AbsoluteX<true>, Op_RMW<Logic_LSR>>(0x5E);
+
+	map_instruction<Mode_Implied, Op_NOP>(0xEA);
+
+	map_instruction<Mode_Immediate, Op_ORA>(0x09);
+	map_instruction<Mode_ZeroPage, Op_ORA>(0x05);
+	map_instruction<Mode_ZeroPageX, Op_ORA>(0x15);
+	map_instruction<Mode_Absolute, Op_ORA>(0x0D);
+	map_instruction<Mode_AbsoluteX<Op_ORA::is_rmw>, Op_ORA>(0x1D);
+	map_instruction<Mode_AbsoluteY<Op_ORA::is_rmw>, Op_ORA>(0x19);
+	map_instruction<Mode_IndirectX, Op_ORA>(0x01);
+	map_instruction<Mode_IndirectY<Op_ORA::is_rmw>, Op_ORA>(0x11);
+
+	map_standalone_instruction<Op_PHA>(0x48);
+	map_standalone_instruction<Op_PHP>(0x08);
+	map_standalone_instruction<Op_PLA>(0x68);
+	map_standalone_instruction<Op_PLP>(0x28);
+
+	map_instruction<Mode_Implied, Op_ROL_Accumulator>(0x2A);
+	map_instruction<Mode_ZeroPage, Op_RMW<Logic_ROL>>(0x26);
+	map_instruction<Mode_ZeroPageX, Op_RMW<Logic_ROL>>(0x36);
+	map_instruction<Mode_Absolute, Op_RMW<Logic_ROL>>(0x2E);
+	map_instruction<Mode_AbsoluteX<true>, Op_RMW<Logic_ROL>>(0x3E);
+
+	map_instruction<Mode_Implied, Op_ROR_Accumulator>(0x6A);
+	map_instruction<Mode_ZeroPage, Op_RMW<Logic_ROR>>(0x66);
+	map_instruction<Mode_ZeroPageX, Op_RMW<Logic_ROR>>(0x76);
+	map_instruction<Mode_Absolute, Op_RMW<Logic_ROR>>(0x6E);
+	map_instruction<Mode_AbsoluteX<true>, Op_RMW<Logic_ROR>>(0x7E);
+
+
+	map_standalone_instruction<Op_RTI>(0x40);
+	map_standalone_instruction<Op_RTS>(0x60);
+
+	map_instruction<Mode_IndirectX, Op_SBC>(0xE1);
+	map_instruction<Mode_ZeroPage, Op_SBC>(0xE5);
+	map_instruction<Mode_Immediate, Op_SBC>(0xE9);
+	map_instruction<Mode_Absolute, Op_SBC>(0xED);
+	map_instruction<Mode_IndirectY<Op_SBC::is_rmw>, Op_SBC>(0xF1);
+	map_instruction<Mode_ZeroPageX, Op_SBC>(0xF5);
+	map_instruction<Mode_AbsoluteY<Op_SBC::is_rmw>, Op_SBC>(0xF9);
+	map_instruction<Mode_AbsoluteX<Op_SBC::is_rmw>, Op_SBC>(0xFD);
+
+	map_instruction<Mode_Implied, Op_SEC>(0x38);
+	map_instruction<Mode_Implied, Op_SED>(0xF8);
+	map_instruction<Mode_Implied, Op_SEI>(0x78);
+
+	map_instruction<Mode_IndirectX, Op_STA>(0x81);
+	map_instruction<Mode_ZeroPage, Op_STA>(0x85);
+	map_instruction<Mode_Absolute, Op_STA>(0x8D);
+	map_instruction<Mode_IndirectY<Op_STA::is_rmw>, Op_STA>(0x91);
+	map_instruction<Mode_ZeroPageX, Op_STA>(0x95);
+	map_instruction<Mode_AbsoluteY<Op_STA::is_rmw>, Op_STA>(0x99);
+	map_instruction<Mode_AbsoluteX<Op_STA::is_rmw>, Op_STA>(0x9D);
+
+	map_instruction<Mode_ZeroPage, Op_STX>(0x86);
+	map_instruction<Mode_ZeroPageY, Op_STX>(0x96);
+	map_instruction<Mode_Absolute, Op_STX>(0x8E);
+
+	map_instruction<Mode_ZeroPage, Op_STY>(0x84);
+	map_instruction<Mode_ZeroPageX, Op_STY>(0x94);
+	map_instruction<Mode_Absolute, Op_STY>(0x8C);
+
+	map_instruction<Mode_Implied, Op_TAX>(0xAA);
+	map_instruction<Mode_Implied, Op_TAY>(0xA8);
+	map_instruction<Mode_Implied, Op_TSX>(0xBA);
+	map_instruction<Mode_Implied, Op_TXA>(0x8A);
+	map_instruction<Mode_Implied, Op_TXS>(0x9A);
+	map_instruction<Mode_Implied, Op_TYA>(0x98);
 
 	// Phantom op codes
-	opcode_table[OP_NMI] = &run_standalone_instruction<Op_HardwareInterrupt_NMI>;
-	opcode_table[OP_IRQ] = &run_standalone_instruction<Op_HardwareInterrupt_IRQ>;
-	opcode_table[OP_RESET] = &run_standalone_instruction<Op_HardwareReset>;
+	map_standalone_instruction<Op_HardwareInterrupt_NMI>(OP_NMI);
+	map_standalone_instruction<Op_HardwareInterrupt_IRQ>(OP_IRQ);
+	map_standalone_instruction<Op_HardwareReset>(OP_RESET);
 
 	// Unnoficial op codes
-	opcode_table[0x04] = &run_instruction<Mode_ZeroPage, Op_NOP>;
+	map_instruction<Mode_ZeroPage, Op_NOP>(0x04);
 }
 
 void CPU::buildMap() {
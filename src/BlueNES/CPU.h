@@ -3,6 +3,7 @@
 #include <array>
 #include <string>
 #include <functional>
+#include <utility>
 
 class DebuggerContext;
 
@@ -20,6 +21,8 @@ class DebuggerContext;
 
 //#define CPUDEBUG
 //#define NMIDEBUG
+// Headless builds: drop the debugger hooks from the tick loop entirely.
+//#define CPU_NO_DEBUGGER
 
 #define FLAG_CARRY     0x01
 #define FLAG_ZERO      0x02
@@ -219,6 +222,11 @@ public:
 	uint64_t GetCycleCount();
 	Bus* bus;
 	void Activate(bool active);
+	bool IsActive() const { return isActive; }
+	// No NMI or IRQ is on its way in, so the next cycles don't depend on the interrupt pipeline.
+	bool InterruptsQuiet() const {
+		return !nmi_need && !nmi_previous_need && nmi_line == nmi_previous && !run_irq && !prev_run_irq && !reset_line;
+	}
 	void SetPC(uint16_t address);
 	uint16_t GetPC();
 	uint8_t GetStatus();
@@ -258,8 +266,20 @@ public:
 	static constexpr uint16_t OP_IRQ = 0x101;
 	static constexpr uint16_t OP_RESET = 0x102;
 
+	// Debug policies for the tick loop. NoDebug has no breakpoint check and no
+	// instruction fetch logging at all, WithDebug is what the debugger windows need.
+	struct NoDebug { static constexpr bool enabled = false; };
+	struct WithDebug { static constexpr bool enabled = true; };
+
 	// The CPU Tick Loop
 	void cpu_tick();
+	// Both tick variants run off the same state, so the switch is safe between any two cycles.
+	void SetDebuggerAttached(bool attached) { debuggerAttached = attached; }
+	bool IsDebuggerAttached() const { return debuggerAttached; }
+	// Use the flattened (opcode, step) dispatch table instead of opcode_table.
+	// Same micro-ops underneath, so the results are bit-exact either way.
+	void SetFlatDispatch(bool enabled) { flatDispatch = enabled; }
+	bool IsFlatDispatch() const { return flatDispatch; }
 	// Helper to update Zero and Negative flags
 	void update_ZN_flags(uint8_t value) {
 		if (value == 0) m_p |= 0x02; else m_p &= ~0x02; // Zero Flag
@@ -2139,11 +2159,88 @@ private:
 		}
 	}
 
+	// Flattened dispatch (the second engine).
+	// run_instruction re-checks addr_complete and switches on cycle_state every cycle.
+	// Here every (opcode, step) pair gets its own instantiation. The step is the cycle_state
+	// while addressing (0-7), or OP_STEP_BASE + cycle_state once the address is complete.
+	// __assume tells the compiler which step it is in, so the switches inside Mode::step and
+	// Op::step fold down to the single case that runs. A cycle is then one indirect call.
+	static constexpr int OP_STEP_BASE = 8;
+	static constexpr int DISPATCH_STEPS = 16;
+
+	template <typename Mode, typename Op, int Step>
+	static void run_instruction_step(CPU& cpu) {
+		if constexpr (Step < OP_STEP_BASE) {
+			__assume(cpu.cycle_state == Step);
+			cpu.addr_complete = Mode::step(cpu);
+			if (!cpu.addr_complete) {
+				return;
+			}
+			// Reset cycle state for Op execution
+			cpu.cycle_state = 0;
+		}
+		else {
+			__assume(cpu.cycle_state == Step - OP_STEP_BASE);
+		}
+		if (Op::step(cpu)) {
+			cpu.inst_complete = true;
+			cpu.cycle_state = 0;
+			cpu.addr_complete = false;
+		}
+	}
+
+	// Standalone and accumulator instructions never set addr_complete, so only the low steps are used.
+	template <typename Op, int Step>
+	static void run_standalone_step(CPU& cpu) {
+		if constexpr (Step < OP_STEP_BASE) {
+			__assume(cpu.cycle_state == Step);
+		}
+		run_standalone_instruction<Op>(cpu);
+	}
+
+	template <typename Op, int Step>
+	static void run_accumulator_step(CPU& cpu) {
+		if constexpr (Step < OP_STEP_BASE) {
+			__assume(cpu.cycle_state == Step);
+		}
+		run_accumulator_instruction<Op>(cpu);
+	}
+
 	// Define a function pointer type for our micro-op handlers
 	typedef void (*InstructionHandler)(CPU&);
 
 	// The Lookup Table
-	InstructionHandler opcode_table[258];
+	InstructionHandler opcode_table[OP_RESET + 1];
+	// The flattened table, indexed by [opcode][step]
+	InstructionHandler step_table[OP_RESET + 1][DISPATCH_STEPS];
+	bool flatDispatch = false;
+
+	// Fill both tables for an opcode
+	template <typename Mode, typename Op>
+	void map_instruction(uint16_t opcode) {
+		opcode_table[opcode] = &run_instruction<Mode, Op>;
+		map_steps(opcode, [](auto step) { return &run_instruction_step<Mode, Op, decltype(step)::value>; },
+			std::make_integer_sequence<int, DISPATCH_STEPS>{});
+	}
+
+	template <typename Op>
+	void map_standalone_instruction(uint16_t opcode) {
+		opcode_table[opcode] = &run_standalone_instruction<Op>;
+		map_steps(opcode, [](auto step) { return &run_standalone_step<Op, decltype(step)::value>; },
+			std::make_integer_sequence<int, DISPATCH_STEPS>{});
+	}
+
+	template <typename Op>
+	void map_accumulator_instruction(uint16_t opcode) {
+		opcode_table[opcode] = &run_accumulator_instruction<Op>;
+		map_steps(opcode, [](auto step) { return &run_accumulator_step<Op, decltype(step)::value>; },
+			std::make_integer_sequence<int, DISPATCH_STEPS>{});
+	}
+
+	template <typename Factory, int... Steps>
+	void map_steps(uint16_t opcode, Factory factory, std::integer_sequence<int, Steps...>) {
+		((step_table[opcode][Steps] = factory(std::integral_constant<int, Steps>{})), ...);
+	}
 
 	OpenBusMapper& openBus;
 	DebuggerContext& dbgCtx;
@@ -2183,6 +2280,9 @@ private:
 	uint8_t m_p;
 
 	bool isActive = false;
+	bool debuggerAttached = false;
+	template<typename DebugPolicy>
+	void tick();
 
 	inline void SetZero(uint8_t value);
 	inline void SetNegative(uint8_t value);
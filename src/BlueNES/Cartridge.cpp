@@ -93,6 +93,7 @@ std::filesystem::path Cartridge::getAndEnsureSavePath() {
 
 void Cartridge::loadSRAM() {
     mapper->m_prgRamData.resize(0x2000);
+    mapper->MapBusPages();
     if (!isBatteryBacked) {
         return;
     }
@@ -121,8 +122,12 @@ void Cartridge::saveSRAM() {
     out.write(reinterpret_cast<const char*>(mapper->m_prgRamData.data()), mapper->m_prgRamData.size());
 }
 
-void Cartridge::unload() {
-    saveSRAM();
+void Cartridge::unload(bool writeSRAM) {
+    if (writeSRAM) {
+        saveSRAM();
+    }
+    // Don't leave the bus pointing at memory we're about to free
+    m_bus->UnmapPages(0x6000, 0xFFFF);
     if (mapper) {
         mapper->m_prgRomData.clear();
         mapper->m_chrData.clear();
@@ -131,6 +136,7 @@ void Cartridge::unload() {
         delete mapper;
         mapper = nullptr;
     }
+    romHash = 0;
     m_isLoaded = false;
 }
 
@@ -172,6 +178,7 @@ void Cartridge::LoadROM(const std::string& filePath) {
     SetMapper(mapperNum, inesFile);
 	mapper->initialize(inesFile);
 	mapper->register_memory(*m_bus);
+    romHash = HashROM();
     loadSRAM();
     
     m_isLoaded = true;
@@ -224,6 +231,21 @@ void Cartridge::WritePRGRAM(uint16_t address, uint8_t data) {
     mapper->m_prgRamData[address - 0x6000] = data;
 }
 
+// FNV-1a, CHR-RAM isn't part of the game
+uint64_t Cartridge::HashROM() {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    auto add = [&hash](const std::vector<uint8_t>& data) {
+        for (uint8_t b : data) {
+            hash = (hash ^ b) * 0x100000001B3ull;
+        }
+    };
+    add(mapper->m_prgRomData);
+    if (!mapper->isCHRWritable) {
+        add(mapper->m_chrData);
+    }
+    return hash;
+}
+
 // ---------------- Debug helper ----------------
 inline void Cartridge::dbg(const wchar_t* fmt, ...) {
     wchar_t buf[512];
@@ -32,11 +32,14 @@ public:
 	void SetPrgRamEnabled(bool enable);
 	bool isPrgRamEnabled = true;
 	void SetMapper(uint8_t value, ines_file_t& inesFile);
-	void unload();
+	// writeSRAM = false leaves the .sav file alone, for a copy of the game that isn't the one being played
+	void unload(bool writeSRAM = true);
 	bool isLoaded();
-	MapperBase* mapper;
+	MapperBase* mapper = nullptr;
 	SharedContext& ctx;
 	std::wstring fileName;
+	// Of the PRG and CHR ROM, save states carry it so they're only loaded into the game they're from
+	uint64_t romHash = 0;
 	std::filesystem::path getAndEnsureSavePath();
 private:
 	Bus* m_bus;
@@ -45,6 +48,7 @@ private:
 	std::vector<uint8_t> LoadFileToBuffer(const std::string& path);
 	void loadSRAM();
 	void saveSRAM();
+	uint64_t HashROM();
 	bool isBatteryBacked = false;
 	bool m_isLoaded;
 	inline void dbg(const wchar_t* fmt, ...);
@@ -14,13 +14,15 @@ public:
         RESET,
         POWER,
         CLOSE,
-        SAVE_STATE,
-        LOAD_STATE,
+        SAVE_STATE, // data is the slot
+        LOAD_STATE, // data is the slot
         PAUSE,
         RESUME,
         STEP_FRAME,
         ADD_CONTROLLER,
-        REMOVE_CONTROLLER
+        REMOVE_CONTROLLER,
+        LOAD_PALETTE,
+        RUN_AHEAD // data is "<frames> <second instance 0/1>"
     };
 
     struct Command {
@@ -135,6 +135,20 @@ void Core::LoadGame(const std::string& filePath) {
     isPlaying = true;
 }
 
+void Core::SetRunAhead(int frames, bool secondInstance) {
+    CommandQueue::Command cmd;
+    cmd.type = CommandQueue::CommandType::RUN_AHEAD;
+    cmd.data = std::to_string(frames) + " " + (secondInstance ? "1" : "0");
+    context.command_queue.Push(cmd);
+}
+
+void Core::LoadPalette(const std::string& filePath) {
+    CommandQueue::Command cmd;
+    cmd.type = CommandQueue::CommandType::LOAD_PALETTE;
+    cmd.data = filePath;
+    context.command_queue.Push(cmd);
+}
+
 // Function to convert std::string (UTF-8) to std::wstring (UTF-16/UTF-32 depending on platform)
 //std::wstring stringToWstring(const std::string& str) {
 //    // Using UTF-8 to wide string conversion
@@ -309,8 +323,7 @@ void Core::RunMessageLoop()
     int frameCount = 0;
 
     int ui_fps = 0;
-    const uint32_t* prev_frame_data = nullptr;
-	uint32_t dupCount = 0;
+	uint32_t frameTimeouts = 0; // Waits that ended with no new frame, the last one stayed up
     
     while (!shutdown) {
         shutdown = PollSDLEvents();
@@ -326,10 +339,9 @@ void Core::RunMessageLoop()
             // If the Core hangs, we wake up in 20ms anyway to handle SDL events again.
             const uint32_t* frame_data = context.WaitForNewFrame(20);
 
-            if (prev_frame_data == frame_data) {
-                dupCount++;
+            if (!frame_data) {
+                frameTimeouts++;
             }
-			prev_frame_data = frame_data;
             if (frame_data) {
                 RenderFrame(frame_data);
                 got_new_frame = true;
@@ -372,13 +384,24 @@ void Core::RunMessageLoop()
                         if (ImGui::MenuItem("Save State", nullptr, false, isPlaying)) {
                             CommandQueue::Command cmd;
                             cmd.type = CommandQueue::CommandType::SAVE_STATE;
+                            cmd.data = std::to_string(stateSlot);
                             context.command_queue.Push(cmd);
                         }
                         if (ImGui::MenuItem("Load State", nullptr, false, isPlaying)) {
                             CommandQueue::Command cmd;
                             cmd.type = CommandQueue::CommandType::LOAD_STATE;
+                            cmd.data = std::to_string(stateSlot);
                             context.command_queue.Push(cmd);
                         }
+                        if (ImGui::BeginMenu("State Slot")) {
+                            for (int n = 0; n < SaveStateWriter::SLOTS; n++) {
+                                std::string label = "Slot " + std::to_string(n);
+                                if (ImGui::MenuItem(label.c_str(), nullptr, stateSlot == n)) {
+                                    stateSlot = n;
+                                }
+                            }
+                            ImGui::EndMenu();
+                        }
                     ImGui::Separator();
                     if (ImGui::MenuItem("Exit")) shutdown = true;
                     ImGui::EndMenu();
@@ -396,6 +419,35 @@ void Core::RunMessageLoop()
                         context.command_queue.Push(cmd);
                         isPlaying = true;
                     }
+                    // Saved for the game that's loaded
+                    if (ImGui::BeginMenu("Run-Ahead", isPlaying)) {
+                        int frames = context.runAheadFrames.load();
+                        bool secondInstance = context.runAheadSecondInstance.load();
+                        const char* labels[] = { "Off", "1 Frame", "2 Frames", "3 Frames" };
+                        for (int n = 0; n < 4; n++) {
+                            if (ImGui::MenuItem(labels[n], nullptr, frames == n)) {
+                                frames = n;
+                                SetRunAhead(frames, secondInstance);
+                            }
+                        }
+                        ImGui::Separator();
+                        if (ImGui::MenuItem("Second Instance", nullptr, secondInstance)) {
+                            SetRunAhead(frames, !secondInstance);
+                        }
+                        ImGui::EndMenu();
+                    }
+                    ImGui::Separator();
+                    if (ImGui::MenuItem("Load Palette...")) {
+                        IGFD::FileDialogConfig config;
+                        config.path = lastOpenedPath;
+                        config.sidePaneWidth = 200.0f;
+                        config.flags = ImGuiFileDialogFlags_Modal | ImGuiFileDialogFlags_HideColumnType | ImGuiFileDialogFlags_ShowDevicesButton;
+
+                        ImGuiFileDialog::Instance()->OpenDialog("ChoosePaletteKey", "Select Palette", "Palette files{.pal},.pal,All files{.*}", config);
+                    }
+                    if (ImGui::MenuItem("Default Palette")) {
+                        LoadPalette("");
+                    }
                     ImGui::EndMenu();
                 }
                 if (ImGui::BeginMenu("Debug")) {
@@ -432,10 +484,23 @@ void Core::RunMessageLoop()
 
                 ImGuiFileDialog::Instance()->Close();
             }
+            if (ImGuiFileDialog::Instance()->Display("ChoosePaletteKey", ImGuiWindowFlags_NoCollapse, minSize, maxSize)) {
+                if (ImGuiFileDialog::Instance()->IsOk()) {
+                    LoadPalette(ImGuiFileDialog::Instance()->GetFilePathName());
+                }
+
+                ImGuiFileDialog::Instance()->Close();
+            }
 
             // Get the size of the current window to scale the image
             ImVec2 viewportPanelSize = ImGui::GetContentRegionAvail();
 
+            // The core only copies out PPU state while a window showing it is open
+            if (_uiWindows.cpuOpen || _uiWindows.hexOpen || _uiWindows.ppuOpen) {
+                _dbgCtx->RequestPPUSnapshot();
+                _dbgCtx->RefreshPPUState();
+            }
+
             // Debugger Window (CPU Registers)
             ImGui::SetNextWindowPos(ImVec2(1100, 600), ImGuiCond_FirstUseEver);
             if (_uiWindows.cpuOpen) {
@@ -481,11 +546,28 @@ void Core::RunMessageLoop()
 
 			ppuViewer.Draw("PPU Viewer", &_uiWindows.ppuOpen);
 
+            // The fetch log is only worth paying for while someone is looking. Breakpoints and
+            // stepping work either way, see DebuggerContext::IsAttached().
+            _dbgCtx->fetchLogging.store(_uiWindows.cpuOpen || _uiWindows.debuggerOpen, std::memory_order_relaxed);
+
             // NES Display Window
             ImGui::SetNextWindowSize(ImVec2(800, 600), ImGuiCond_FirstUseEver);
             ImGui::SetNextWindowPos(ImVec2(300, 30), ImGuiCond_FirstUseEver);
             ImGui::Begin("Game View");
-            ImGui::Text("FPS: %d, UI FPS %d, dup %d", (int)context.current_fps.load(std::memory_order_relaxed), ui_fps, dupCount);
+            ImGui::Text("FPS: %d, UI FPS %d, timeouts %u, dropped %llu", (int)context.current_fps.load(std::memory_order_relaxed), ui_fps, frameTimeouts,
+                (unsigned long long)context.GetDroppedFrames());
+            ImGui::Text("Rewind: %u states, %u bytes/frame, capture %u us", context.rewindStates.load(std::memory_order_relaxed),
+                context.rewindBytesPerFrame.load(std::memory_order_relaxed), context.rewindCaptureUs.load(std::memory_order_relaxed));
+            if (context.runAheadFrames.load(std::memory_order_relaxed) > 0) {
+                ImGui::Text("Run-ahead: %d frames%s, %u us/frame", (int)context.runAheadFrames.load(std::memory_order_relaxed),
+                    context.runAheadSecondInstance.load(std::memory_order_relaxed) ? " (second instance)" : "",
+                    context.runAheadOverheadUs.load(std::memory_order_relaxed));
+            }
+            if (context.saveStateBytes.load(std::memory_order_relaxed) > 0 || context.saveStateFailed.load(std::memory_order_relaxed)) {
+                ImGui::Text("Save state: %u bytes, snapshot %u us, on disk after %u us%s", context.saveStateBytes.load(std::memory_order_relaxed),
+                    context.saveStateSnapshotUs.load(std::memory_order_relaxed), context.saveStateLatencyUs.load(std::memory_order_relaxed),
+                    context.saveStateFailed.load(std::memory_order_relaxed) ? " (last one failed)" : "");
+            }
 
             DrawGameCentered();
             ImGui::End();
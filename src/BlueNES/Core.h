@@ -101,6 +101,10 @@ private:
 	Bus* _bus;
 	DebuggerContext* _dbgCtx;
 	void updateMenu();
+	void SetRunAhead(int frames, bool secondInstance);
+	// An empty path goes back to the built-in palette
+	void LoadPalette(const std::string& filePath);
+	int stateSlot = 0; // What Save State and Load State use
 	bool RenderFrame(const uint32_t* frame_data);
 	bool ClearFrame();
 	void DrawGameCentered();
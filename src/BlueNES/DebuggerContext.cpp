@@ -6,5 +6,41 @@ bool DebuggerContext::HasBreakpoint(uint16_t addr) {
 }
 
 void DebuggerContext::ToggleBreakpoint(uint16_t addr) {
-    breakpoints[addr].store(~breakpoints[addr].load(std::memory_order_relaxed), std::memory_order_relaxed);
-}
\ No newline at end of file
+    SetBreakpoint(addr, !HasBreakpoint(addr));
+}
+
+void DebuggerContext::SetBreakpoint(uint16_t addr, bool set) {
+    uint8_t was = breakpoints[addr].exchange(set ? 0xFF : 0, std::memory_order_relaxed);
+    if (set && !was) {
+        breakpointCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (!set && was) {
+        breakpointCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+DebuggerContext::PPUState& DebuggerContext::BeginPPUSnapshot() {
+    uint32_t seq = ppuSnapshotSeq.load(std::memory_order_relaxed);
+    ppuSnapshotSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    // The next snapshot goes into the buffer the latest one isn't in
+    return ppuSnapshots[(seq / 2 + 1) & 1];
+}
+
+void DebuggerContext::PublishPPUSnapshot() {
+    ppuSnapshotSeq.fetch_add(1, std::memory_order_release);
+    ppuSnapshotWanted.store(false, std::memory_order_relaxed);
+}
+
+void DebuggerContext::RefreshPPUState() {
+    while (true) {
+        uint32_t seq = ppuSnapshotSeq.load(std::memory_order_acquire);
+        uint32_t latest = seq / 2;
+        ppuState = ppuSnapshots[latest & 1];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // The buffer only gets written again when snapshot latest + 2 is started
+        if (ppuSnapshotSeq.load(std::memory_order_relaxed) <= latest * 2 + 2) {
+            return;
+        }
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <mutex>
+#include <atomic>
 #include <array>
 #include <string>
 #include <Windows.h>
@@ -68,6 +69,8 @@ public:
 
     bool HasBreakpoint(uint16_t addr);
 	void ToggleBreakpoint(uint16_t addr);
+	// Keeps count, so the core can tell whether any are set without looking through all of them
+	void SetBreakpoint(uint16_t addr, bool set);
 
     std::mutex mutex;
     std::atomic<uint8_t> breakpoints[65536];
@@ -79,6 +82,37 @@ public:
 
     std::atomic<uint16_t> step_over_target{ 0xFFFF };
 
+    // Set by the UI while a CPU/debugger window is open, the disassembler uses the fetch log
+    std::atomic<bool> fetchLogging{ false };
+
+    // Anything that needs the CPU's instrumented tick: breakpoints, a pause or step, the fetch log.
+    // The core checks once per frame. Breakpoints fire with every debug window closed.
+    bool IsAttached() const {
+        return breakpointCount.load(std::memory_order_relaxed) > 0 || is_paused.load(std::memory_order_relaxed) ||
+            step_requested.load(std::memory_order_relaxed) || fetchLogging.load(std::memory_order_relaxed);
+    }
+
     CpuState lastState{};
+    // The UI's copy of the PPU state, filled in by RefreshPPUState()
     PPUState ppuState{};
+
+    // PPU snapshots are only taken while the UI asks for them. The core checks once a frame and
+    // writes into whichever of the two buffers isn't the latest, so the UI can copy the latest one
+    // without locking and almost never has to retry.
+    // UI: ask for the next frame's snapshot. Call every frame the PPU state is on screen.
+    void RequestPPUSnapshot() { ppuSnapshotWanted.store(true, std::memory_order_relaxed); }
+    // UI: copy the latest snapshot into ppuState
+    void RefreshPPUState();
+    // Core: is anyone looking?
+    bool PPUSnapshotWanted() const { return ppuSnapshotWanted.load(std::memory_order_relaxed); }
+    // Core: the buffer to fill in, then PublishPPUSnapshot()
+    PPUState& BeginPPUSnapshot();
+    void PublishPPUSnapshot();
+
+private:
+    std::atomic<uint32_t> breakpointCount{ 0 };
+    PPUState ppuSnapshots[2]{};
+    // Odd while the core is writing a snapshot. Snapshot n is in ppuSnapshots[n & 1], and seq / 2 have been published.
+    std::atomic<uint32_t> ppuSnapshotSeq{ 0 };
+    std::atomic<bool> ppuSnapshotWanted{ false };
 };
\ No newline at end of file
@@ -234,8 +234,7 @@ void DebuggerUI::DrawScrollableDisassembler(bool* debuggerOpen) {
                 // This targets the Selectable we just created
                 if (ImGui::BeginPopupContextItem()) {
                     if (ImGui::MenuItem("Add Breakpoint", nullptr, hasBreakpoint)) {
-                        if (hasBreakpoint) dbgCtx->breakpoints[addr].store(false);
-                        else dbgCtx->breakpoints[addr].store(true);
+                        dbgCtx->SetBreakpoint(addr, !hasBreakpoint);
                     }
                     if (ImGui::MenuItem("Copy Address")) {
                         ImGui::SetClipboardText(addrStr);
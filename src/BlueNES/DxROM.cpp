@@ -63,13 +63,17 @@ void DxROM::writeRegister(uint16_t addr, uint8_t val, uint64_t currentCycle) {
 
 void DxROM::Serialize(Serializer& serializer) {
 	MapperBase::Serialize(serializer);
+	serializer.BeginChunk(ChunkTag("DxRO"));
 	serializer.Write(_banks, 8);
 	serializer.Write(_regSelect);
+	serializer.EndChunk();
 }
 
 void DxROM::Deserialize(Serializer& serializer) {
 	MapperBase::Deserialize(serializer);
+	serializer.RequireChunk(ChunkTag("DxRO"));
 	serializer.Read(_banks, 8);
 	serializer.Read(_regSelect);
+	serializer.CloseChunk();
 	RecomputeMappings();
 }
\ No newline at end of file
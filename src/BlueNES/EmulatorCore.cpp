@@ -10,7 +10,10 @@
 #include "Input.h"
 #include <vector>
 #include "Serializer.h"
+#include "MappedFile.h"
 #include <fstream>
+#include <sstream>
+#include <algorithm>
 #include "DebuggerContext.h"
 #include "RendererLoopy.h"
 
@@ -87,7 +90,22 @@ void EmulatorCore::run() {
         }
 
         nes.input_->PollControllerState();
+        nes.cpu_->SetDebuggerAttached(dbgCtx->IsAttached());
+        // While rewinding each frame starts from an older capture, and nothing is captured
+        bool rewinding = nes.input_->IsRewindHeld() && rewind.StepBack(nes);
+        // With run-ahead the real frame isn't shown, the last frame ahead is
+        bool runningAhead = runAhead.IsEnabled() && !rewinding;
+        nes.ppu_->SetSkipOutput(runningAhead);
         audioCycleCounter += runFrame();
+        if (runningAhead) {
+            runAhead.Start(context.GetBackBuffer());
+        }
+        if (!rewinding) {
+            rewind.OnFrame(nes);
+        }
+        if (runningAhead) {
+            runAhead.Finish();
+        }
         context.SwapBuffers();
         frameCount++;
 
@@ -105,6 +123,12 @@ void EmulatorCore::run() {
 			// Update FPS once per second
 			LOG(L"FPS: %d, cycles: %d\n", frameCount, audioCycleCounter);
             context.current_fps.store(frameCount);
+            context.rewindStates.store((uint32_t)rewind.GetCount());
+            context.rewindBytesPerFrame.store((uint32_t)(rewind.GetAverageDeltaBytes() / rewind.GetInterval()));
+            context.rewindCaptureUs.store((uint32_t)(rewind.GetAverageCaptureNs() / 1000));
+            rewind.ResetStats();
+            context.runAheadOverheadUs.store((uint32_t)(runAhead.GetAverageOverheadNs() / 1000));
+            runAhead.ResetStats();
             frameCount = 0;
             audioCycleCounter = 0;
             nextFpsUpdateTime += freq;
@@ -140,9 +164,15 @@ int EmulatorCore::runFrame() {
     nes.ppu_->setBuffer(context.GetBackBuffer());
     // Run PPU until frame complete (89342 cycles per frame)
 	while (!nes.frameReady() && context.is_running) {
-        nes.clock();
+        if (nes.instructionStepped) {
+            nes.stepInstruction();
+        }
+        else {
+            nes.clock();
+        }
 	}
 	if (!context.is_running) return 0;
+    nes.endAudioFrame();
 
     // Submit the exact samples generated this frame
     // Check audio queue to prevent unbounded growth
@@ -168,6 +198,13 @@ void EmulatorCore::processCommand(const CommandQueue::Command& cmd) {
         nes.bus_->PowerCycle();
         nes.cart_->LoadROM(cmd.data);
         nes.cpu_->PowerCycle();
+        rewind.Clear();
+        romPath = cmd.data;
+        // Saving a state shouldn't touch the disk on this thread, not even to check the folder is there
+        saveFolder = nes.cart_->getAndEnsureSavePath();
+        // A second instance still has the last game in it
+        runAhead.SetSecondInstance(false, romPath);
+        LoadRunAheadSettings();
         m_paused = false;
         UpdateNextFrameTime();
         // Set up DMC read callback
@@ -192,6 +229,9 @@ void EmulatorCore::processCommand(const CommandQueue::Command& cmd) {
         break;
     case CommandQueue::CommandType::CLOSE:
         context.coreRunning.store(false);
+        rewind.Clear();
+        romPath.clear();
+        SetRunAhead(0, false);
         audioBackend.resetBuffer();
         nes.ppu_->reset();
         nes.apu_->reset();
@@ -218,11 +258,25 @@ void EmulatorCore::processCommand(const CommandQueue::Command& cmd) {
         nes.input_->CloseController();
 		break;
     case CommandQueue::CommandType::SAVE_STATE:
-        CreateSaveState();
+        CreateSaveState(cmd.data.empty() ? 0 : std::stoi(cmd.data));
         break;
     case CommandQueue::CommandType::LOAD_STATE:
-        LoadState();
+        LoadState(cmd.data.empty() ? 0 : std::stoi(cmd.data));
+        break;
+    case CommandQueue::CommandType::LOAD_PALETTE:
+        // An empty path goes back to the built-in palette
+        if (cmd.data.empty() || !nes.ppu_->LoadPalette(cmd.data)) {
+            nes.ppu_->ResetPalette();
+        }
+        runAhead.CopyVideoSettings();
         break;
+    case CommandQueue::CommandType::RUN_AHEAD: {
+        int frames = 0;
+        int secondInstance = 0;
+        std::istringstream(cmd.data) >> frames >> secondInstance;
+        SetRunAhead(frames, secondInstance != 0);
+        SaveRunAheadSettings();
+    } break;
     }
 }
 
@@ -232,28 +286,76 @@ void EmulatorCore::UpdateNextFrameTime() {
     nextFrameUpdateTime = frameEnd_li.QuadPart + ticksPerFrame;
 }
 
-void EmulatorCore::CreateSaveState() {
-    std::filesystem::path appFolder = nes.cart_->getAndEnsureSavePath();
-    std::filesystem::path stateFilePath = appFolder / (nes.cart_->fileName + L".000");
-    std::ofstream os(stateFilePath, std::ios::binary);
-    Serializer serializer;
-	serializer.StartSerialization(os);
-    nes.Serialize(serializer);
-    if (!os) {
-        LOG(L"Failed to open save state file for writing: %s\n", stateFilePath.c_str());
-        return;
-	}
+// Slot 0 is the .000 file there always was
+std::filesystem::path EmulatorCore::StatePath(int slot) {
+    slot = (std::max)(0, (std::min)(slot, SaveStateWriter::SLOTS - 1));
+    return saveFolder / (nes.cart_->fileName + L".00" + std::to_wstring(slot));
+}
+
+void EmulatorCore::CreateSaveState(int slot) {
+    // Only the snapshot happens here, compressing and the disk are on the writer's thread
+    auto requested = std::chrono::steady_clock::now();
+    StateBuffer state = saveWriter.TakeBuffer();
+    nes.SaveToBuffer(state);
+    saveWriter.Write(std::move(state), StatePath(slot), requested);
+    auto snapshot = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - requested);
+    context.saveStateSnapshotUs.store((uint32_t)snapshot.count(), std::memory_order_relaxed);
 }
 
-void EmulatorCore::LoadState() {
-    std::filesystem::path appFolder = nes.cart_->getAndEnsureSavePath();
-    std::filesystem::path stateFilePath = appFolder / (nes.cart_->fileName + L".000");
-    std::ifstream is(stateFilePath, std::ios::binary);
-    if (!is) {
+void EmulatorCore::LoadState(int slot) {
+    // A save of this slot may still be on its way to the disk
+    saveWriter.Flush();
+    std::filesystem::path stateFilePath = StatePath(slot);
+    MappedFile file;
+    if (!file.Open(stateFilePath)) {
         LOG(L"Failed to open save state file for reading: %s\n", stateFilePath.c_str());
         return;
     }
-    Serializer serializer;
-    serializer.StartDeserialization(is);
-    nes.Deserialize(serializer);
+    try {
+        Serializer serializer;
+        if (SaveStateWriter::IsCompressed(file.data(), file.size())) {
+            SaveStateWriter::Decompress(file.data(), file.size(), loadBuffer);
+            serializer.StartDeserialization(loadBuffer.data(), loadBuffer.size);
+        }
+        else {
+            // Read where it's mapped, PRG-RAM and CHR-RAM are copied once, from there into the mapper
+            serializer.StartDeserialization(file.data(), file.size());
+        }
+        // A damaged file leaves the game as it was
+        nes.DeserializeOrRollBack(serializer, rollbackBuffer);
+    }
+    catch (const std::exception& e) {
+        LOG(L"Failed to load save state %s: %S\n", stateFilePath.c_str(), e.what());
+    }
+}
+
+void EmulatorCore::SetRunAhead(int frames, bool secondInstance) {
+    runAhead.SetFrames(frames);
+    // Only worth a thread and a second copy of the game while it's on
+    bool wantSecond = secondInstance && runAhead.IsEnabled() && !romPath.empty();
+    if (wantSecond != runAhead.IsSecondInstance()) {
+        runAhead.SetSecondInstance(wantSecond, romPath);
+    }
+    context.runAheadFrames.store((uint8_t)runAhead.GetFrames());
+    context.runAheadSecondInstance.store(secondInstance);
+}
+
+void EmulatorCore::LoadRunAheadSettings() {
+    std::filesystem::path settingsPath = nes.cart_->getAndEnsureSavePath() / (nes.cart_->fileName + L".runahead");
+    std::ifstream in(settingsPath);
+    int frames = 0;
+    int secondInstance = 0;
+    if (in) {
+        in >> frames >> secondInstance;
+    }
+    SetRunAhead(frames, secondInstance != 0);
+}
+
+void EmulatorCore::SaveRunAheadSettings() {
+    if (romPath.empty()) {
+        return;
+    }
+    std::filesystem::path settingsPath = nes.cart_->getAndEnsureSavePath() / (nes.cart_->fileName + L".runahead");
+    std::ofstream out(settingsPath);
+    out << runAhead.GetFrames() << " " << (context.runAheadSecondInstance.load() ? 1 : 0);
 }
\ No newline at end of file
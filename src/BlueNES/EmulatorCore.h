@@ -3,6 +3,10 @@
 #include "Nes.h"
 #include "AudioBackend.h"
 #include "SharedContext.h"
+#include "Serializer.h"
+#include "RewindBuffer.h"
+#include "RunAhead.h"
+#include "SaveStateWriter.h"
 #include <thread>
 
 #ifdef _DEBUG
@@ -55,7 +59,20 @@ private:
 	long long ticksPerFrame;
 	long long freq;
 	void UpdateNextFrameTime();
-	void CreateSaveState();
-	void LoadState();
+	// data of SAVE_STATE and LOAD_STATE is the slot, 0 to SaveStateWriter::SLOTS - 1
+	void CreateSaveState(int slot);
+	void LoadState(int slot);
+	std::filesystem::path StatePath(int slot);
+	std::filesystem::path saveFolder;
+	SaveStateWriter saveWriter{ context };
+	StateBuffer loadBuffer; // Compressed states are inflated into this
+	StateBuffer rollbackBuffer; // The machine as it was before a load, in case the file is damaged
+	RewindBuffer rewind;
+	RunAhead runAhead{ nes };
+	std::string romPath;
+	// Run-ahead is set per game, in a file next to its save states
+	void SetRunAhead(int frames, bool secondInstance);
+	void LoadRunAheadSettings();
+	void SaveRunAheadSettings();
 	DebuggerContext* dbgCtx;
 };
\ No newline at end of file
@@ -62,6 +62,7 @@ void Input::PollControllerState()
 	if (keys[SDL_SCANCODE_Z]) {
 		controller1 |= BUTTON_SELECT;
 	}
+	rewindHeld = keys[SDL_SCANCODE_BACKSPACE] != 0;
 
 	for (int i = 0; i < controllers.size(); i++) {
 		SDL_GameController* controller = controllers[i];
@@ -25,6 +25,23 @@ public:
 	void OpenFirstController();
 	void CloseController();
 	void PollControllerState();
+	// Both controllers, the buttons held and how far the game is through reading them.
+	// Not part of a save state, so run-ahead carries it over itself.
+	struct State {
+		uint8_t controller1;
+		uint8_t controller1_stream;
+		uint8_t controller2;
+		uint8_t controller2_stream;
+	};
+	State GetState() const { return { controller1, controller1_stream, controller2, controller2_stream }; }
+	void SetState(const State& state) {
+		controller1 = state.controller1;
+		controller1_stream = state.controller1_stream;
+		controller2 = state.controller2;
+		controller2_stream = state.controller2_stream;
+	}
+	// Backspace, read with the controller
+	bool IsRewindHeld() const { return rewindHeld; }
 
 private:
 	std::vector<SDL_GameController*> controllers;
@@ -34,4 +51,5 @@ private:
 	uint8_t controller1_stream;
 	uint8_t controller2;
 	uint8_t controller2_stream;
+	bool rewindHeld = false;
 };
\ No newline at end of file
@@ -260,22 +260,25 @@ void MMC1::RecomputeChrMappings() {
 
 void MMC1::Serialize(Serializer& serializer) {
 	MapperBase::Serialize(serializer);
+	serializer.BeginChunk(ChunkTag("MMC1"));
 	serializer.Write(shiftRegister);
 	serializer.Write(controlReg);
 	serializer.Write(chrBank0Reg);
 	serializer.Write(chrBank1Reg);
 	serializer.Write(prgBankReg);
 	serializer.Write(suromPrgOuterBank);
-
+	serializer.EndChunk();
 }
 
 void MMC1::Deserialize(Serializer& serializer) {
 	MapperBase::Deserialize(serializer);
+	serializer.RequireChunk(ChunkTag("MMC1"));
 	serializer.Read(shiftRegister);
 	serializer.Read(controlReg);
 	serializer.Read(chrBank0Reg);
 	serializer.Read(chrBank1Reg);
 	serializer.Read(prgBankReg);
 	serializer.Read(suromPrgOuterBank);
+	serializer.CloseChunk();
 	RecomputeMappings();
 }
\ No newline at end of file
@@ -7,6 +7,7 @@ MMC2Mapper::MMC2Mapper(Bus& b, uint8_t prgRomSize, uint8_t chrRomSize) : bus(b),
     MapperBase::SetChrPageSize(0x1000); // MMC2 uses 4KB CHR pages
 
     prgBank8kCount = prgRomSize * 2; // iNES gives size in 16KB, we use 8KB
+    _watchesChrReads = true; // Latches switch on pattern fetches
 
     prg_bank_select = 0;
     chr_bank_0[0] = chr_bank_0[1] = 0;
@@ -85,19 +86,23 @@ void MMC2Mapper::RecomputeChrMappings() {
 
 void MMC2Mapper::Serialize(Serializer& serializer) {
     MapperBase::Serialize(serializer);
+    serializer.BeginChunk(ChunkTag("MMC2"));
     serializer.Write(prg_bank_select);
     serializer.Write(chr_bank_0);
     serializer.Write(chr_bank_1);
     serializer.Write(latch_0);
     serializer.Write(latch_1);
+    serializer.EndChunk();
 }
 
 void MMC2Mapper::Deserialize(Serializer& serializer) {
     MapperBase::Deserialize(serializer);
+    serializer.RequireChunk(ChunkTag("MMC2"));
     serializer.Read(prg_bank_select);
     serializer.Read(chr_bank_0);
     serializer.Read(chr_bank_1);
     serializer.Read(latch_0);
     serializer.Read(latch_1);
+    serializer.CloseChunk();
     RecomputeMappings();
 }
\ No newline at end of file
@@ -201,6 +201,13 @@ bool MMC3::IrqPending() {
 
 // Called by PPU when PPU address changes (A12 detection)
 void MMC3::ClockIRQCounter(uint16_t ppu_address) {
+	if (ppu_address >= 0x2000) {
+		return;
+	}
+	ClockIRQCounterAt(ppu_address, bus.ppu.GetCycleCount());
+}
+
+void MMC3::ClockIRQCounterAt(uint16_t ppu_address, uint64_t cycle) {
 	if (ppu_address >= 0x2000) {
 		return;
 	}
@@ -209,7 +216,7 @@ void MMC3::ClockIRQCounter(uint16_t ppu_address) {
 	// Track low-time duration
 	if (current_a12) {
 		// Detect rising edge of A12 (0 -> 1 transition)
-		if (!last_a12 && current_a12 && (cpu.GetCycleCount() - a12LowCycle >= A12_LOW_THRESHOLD)) {
+		if (!last_a12 && current_a12 && (cycle - a12LowCycle >= A12_LOW_THRESHOLD)) {
 		//if (!last_a12 && current_a12) {
 			//LOG(L"Scanline (%d) detected, dec %d \n", bus->ppu->renderer->m_scanline, irq_counter);
 			//if (a12_filter == 0) {
@@ -234,7 +241,8 @@ void MMC3::ClockIRQCounter(uint16_t ppu_address) {
 			//a12_filter = 6;  // Typical filter delay
 		//}
 		}
-		a12LowCycle = cpu.GetCycleCount();
+		// The PPU may be running behind the CPU, so use its idea of the current cycle.
+		a12LowCycle = cycle;
 	}
 
 	last_a12 = current_a12;
@@ -246,6 +254,7 @@ void MMC3::ClockIRQCounter(uint16_t ppu_address) {
 
 void MMC3::Serialize(Serializer& serializer) {
 	MapperBase::Serialize(serializer);
+	serializer.BeginChunk(ChunkTag("MMC3"));
 	serializer.Write(prgMode);
 	serializer.Write(chrMode);
 	serializer.Write(banks, 8);
@@ -259,10 +268,12 @@ void MMC3::Serialize(Serializer& serializer) {
 	serializer.Write(last_a12);
 	serializer.Write(a12LowCycle);
 	serializer.Write(_irqPending);
+	serializer.EndChunk();
 }
 
 void MMC3::Deserialize(Serializer& serializer) {
 	MapperBase::Deserialize(serializer);
+	serializer.RequireChunk(ChunkTag("MMC3"));
 	serializer.Read(prgMode);
 	serializer.Read(chrMode);
 	serializer.Read(banks, 8);
@@ -276,5 +287,6 @@ void MMC3::Deserialize(Serializer& serializer) {
 	serializer.Read(last_a12);
 	serializer.Read(a12LowCycle);
 	serializer.Read(_irqPending);
+	serializer.CloseChunk();
 	RecomputeMappings();
 }
\ No newline at end of file
@@ -28,6 +28,7 @@ public:
 
 	void writeRegister(uint16_t addr, uint8_t val, uint64_t currentCycle);
 	void ClockIRQCounter(uint16_t ppu_address);
+	void ClockIRQCounterAt(uint16_t ppu_address, uint64_t cycle);
 	bool IrqPending();
 	void RecomputePrgMappings() override;
 	void RecomputeChrMappings() override;
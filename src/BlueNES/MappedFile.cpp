@@ -0,0 +1,47 @@
+#include "MappedFile.h"
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const std::filesystem::path& path) {
+    Close();
+    file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    // An empty file can't be mapped
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        Close();
+        return false;
+    }
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        Close();
+        return false;
+    }
+    view = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!view) {
+        Close();
+        return false;
+    }
+    length = (size_t)fileSize.QuadPart;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (view) {
+        UnmapViewOfFile(view);
+        view = nullptr;
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+        mapping = nullptr;
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+    length = 0;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <Windows.h>
+#include <stdint.h>
+#include <filesystem>
+
+// A whole file mapped read-only into memory. Nothing is read up front, pages come in from the
+// file as they're touched.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False if it can't be opened or is empty
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    const uint8_t* data() const { return view; }
+    size_t size() const { return length; }
+
+private:
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    const uint8_t* view = nullptr;
+    size_t length = 0;
+};
@@ -1,5 +1,7 @@
 #include "Mapper.h"
 #include "Bus.h"
+#include "PPU.h"
+#include "APU.h"
 
 uint8_t Mapper::read(uint16_t address) {
 	if (address < 0x8000) {
@@ -26,13 +28,34 @@ void Mapper::write(uint16_t address, uint8_t value) {
 		m_prgRamData[address - 0x6000] = value;
 	}
 	else {
+		// Bank switches and mirroring changes have to land between the right PPU dots.
+		// Same for the DMC, its next sample fetch has to come from the old bank.
+		if (m_bus) {
+			m_bus->ppu.CatchUp();
+			m_bus->apu.catch_up();
+		}
 		writeRegister(address, value, 0);
 	}
 }
 
 void Mapper::register_memory(Bus& bus) {
+	m_bus = &bus;
 	bus.ReadRegisterAdd(0x6000, 0xFFFF, this);
 	bus.WriteRegisterAdd(0x6000, 0xFFFF, this);
+	MapBusPages();
+}
+
+void Mapper::MapBusPages() {
+	if (!m_bus) {
+		return;
+	}
+	// PRG-RAM is plain memory, PRG-ROM writes are mapper registers so those stay on the slow path.
+	if (m_prgRamData.size() >= 0x2000) {
+		m_bus->MapPages(0x6000, 0x7FFF, m_prgRamData.data(), 0x2000, true);
+	}
+	else {
+		m_bus->UnmapPages(0x6000, 0x7FFF);
+	}
 }
 
 void Mapper::initialize(ines_file_t& inesFile) {
@@ -75,15 +98,26 @@ void Mapper::SetPRGRom(uint8_t* data, size_t size) {
 }
 
 void Mapper::Serialize(Serializer& serializer) {
+	// The big ones get chunks of their own, read straight out of a mapped file into place
+	serializer.BeginChunk(CHUNK_PRG_RAM);
 	serializer.WriteVector(m_prgRamData);
+	serializer.EndChunk();
 	if (isCHRWritable) {
+		serializer.BeginChunk(CHUNK_CHR_RAM);
 		serializer.WriteVector(m_chrData);
+		serializer.EndChunk();
 	}
 }
 
 void Mapper::Deserialize(Serializer& serializer) {
+	serializer.RequireChunk(CHUNK_PRG_RAM);
 	serializer.ReadVector(m_prgRamData);
+	serializer.CloseChunk();
 	if (isCHRWritable) {
+		serializer.RequireChunk(CHUNK_CHR_RAM);
 		serializer.ReadVector(m_chrData);
+		serializer.CloseChunk();
 	}
+	// ReadVector may have reallocated PRG-RAM
+	MapBusPages();
 }
\ No newline at end of file
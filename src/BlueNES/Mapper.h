@@ -13,7 +13,7 @@ public:
 	std::vector<uint8_t> m_prgRomData;
 	std::vector<uint8_t> m_prgRamData;
 	std::vector<uint8_t> m_chrData;
-	bool isCHRWritable;
+	bool isCHRWritable = false;
 
 	virtual void initialize(ines_file_t& data);
 	virtual void writeRegister(uint16_t addr, uint8_t val, uint64_t currentCycle) = 0;
@@ -28,12 +28,17 @@ public:
 	uint8_t peek(uint16_t address);
 	void write(uint16_t address, uint8_t value);
 	void register_memory(Bus& bus);
+	// Pushes the directly addressable cartridge memory into the bus page table.
+	// Call again whenever the backing storage moves (bank switch, PRG-RAM resize).
+	virtual void MapBusPages();
 
 	virtual void Serialize(Serializer& serializer) = 0;
 	virtual void Deserialize(Serializer& serializer) = 0;
 
 	void SetCHRRom(uint8_t* data, size_t size);
 	void SetPRGRom(uint8_t* data, size_t size);
+protected:
+	Bus* m_bus = nullptr;
 private:
 
 };
\ No newline at end of file
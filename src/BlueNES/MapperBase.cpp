@@ -1,5 +1,6 @@
 #include "MapperBase.h"
 #include "Serializer.h"
+#include "Bus.h"
 #include <Windows.h>
 
 void MapperBase::initialize(ines_file_t& data) {
@@ -54,6 +55,10 @@ void MapperBase::SetPrgRange(uint16_t startInclusive, uint16_t endExclusive, uin
 
 		// Map the pointer to the specific 256-byte chunk in the ROM
 		_prgPages[i] = &m_prgRomData[bankOffset + relativeOffset];
+		// Keep the bus fast path in sync with the bank switch
+		if (m_bus) {
+			m_bus->readPages[0x80 + i] = _prgPages[i];
+		}
 	}
 }
 
@@ -103,6 +108,17 @@ void MapperBase::RecomputeMappings() {
 	RecomputePrgMappings();
 	RecomputeChrMappings();
 	RecomputeMirrorModeMapping();
+	MapBusPages();
+}
+
+void MapperBase::MapBusPages() {
+	Mapper::MapBusPages();
+	if (!m_bus) {
+		return;
+	}
+	for (int i = 0; i < 0x80; i++) {
+		m_bus->readPages[0x80 + i] = _prgPages[i];
+	}
 }
 
 void MapperBase::SetNametablePage(uint8_t virtualIndex, uint8_t physicalIndex) {
@@ -175,10 +191,14 @@ void MapperBase::shutdown() {
 
 void MapperBase::Serialize(Serializer& serializer) {
 	Mapper::Serialize(serializer);
+	serializer.BeginChunk(CHUNK_VRAM);
 	serializer.WriteVector(_vram);
+	serializer.EndChunk();
 }
 
 void MapperBase::Deserialize(Serializer& serializer) {
 	Mapper::Deserialize(serializer);
+	serializer.RequireChunk(CHUNK_VRAM);
 	serializer.ReadVector(_vram);
+	serializer.CloseChunk();
 }
\ No newline at end of file
@@ -26,7 +26,7 @@ public:
 		SINGLE_UPPER = 3,
 		FOUR_SCREEN = 4
 	};
-	uint8_t* _prgPages[0x100];
+	uint8_t* _prgPages[0x100] = {};
 	uint16_t _prgPageSize = 0;
 	uint16_t _prgRomSize = 0;
 	uint8_t _prgPageCount = 0;
@@ -36,6 +36,9 @@ public:
 	uint16_t _chrRomSize = 0;
 	uint8_t _chrPageCount = 0;
 	const uint16_t _nametablePageSize = 0x400;
+	// The renderer reads pattern bytes straight out of _ppuPages. Mappers that need to see
+	// those reads (MMC2's latches) set this so it goes through readCHR() instead.
+	bool _watchesChrReads = false;
 
 	inline void dbg(const wchar_t* fmt, ...) const;
 	virtual void RecomputeMappings();
@@ -43,6 +46,7 @@ public:
 	virtual void RecomputeChrMappings() = 0;
 	virtual void RecomputeMirrorModeMapping();
 	virtual void initialize(ines_file_t& data) override;
+	virtual void MapBusPages() override;
 	void SetPrgPageSize(uint16_t pageSize);
 	void SetPrgPage(uint16_t pageIndex, uint8_t bank);
 	void SetPrgRange(uint16_t startInclusive, uint16_t endExclusive, uint32_t bankOffset);
@@ -74,5 +78,6 @@ public:
 	virtual void Serialize(Serializer& serializer) override;
 	virtual void Deserialize(Serializer& serializer) override;
 private:
-	MirrorMode m_mirrorMode;
+	// Set from the iNES header on load, mappers made without one start with the nametables mapped too
+	MirrorMode m_mirrorMode = HORIZONTAL;
 };
\ No newline at end of file
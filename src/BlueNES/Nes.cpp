@@ -12,6 +12,10 @@
 #include "OpenBusMapper.h"
 #include "Serializer.h"
 #include "DebuggerContext.h"
+#include "RendererLoopy.h"
+#include "BlipBuffer.h"
+#include <algorithm>
+#include <cmath>
 
 #define PPU_CYCLES_PER_CPU_CYCLE 3
 
@@ -38,6 +42,10 @@ Nes::Nes(SharedContext& ctx) {
     readController2Mapper_ = new ReadController2Mapper(*input_);
     readController2Mapper_->register_memory(*bus_);
     audioBuffer.reserve(4096);
+    // Room for a few frames in case nobody ends the audio frame for a while
+    blip_ = new BlipBuffer(8192);
+    blip_->SetRates(CPU_FREQ, audioSampleRate);
+    apu_->blip = bandLimitedAudio ? blip_ : nullptr;
     dmaActive = false;
 }
 
@@ -58,6 +66,70 @@ Nes::~Nes() {
         delete cart_;
 		cart_ = nullptr;
     }
+    if (blip_) {
+        delete blip_;
+        blip_ = nullptr;
+    }
+}
+
+/// <summary>
+/// Advances the master clock by one CPU cycle worth of PPU dots. In catch-up mode the PPU is only
+/// run once the next event it scheduled (VBlank/NMI, mapper IRQ edge) falls inside this cycle.
+/// Register accesses catch it up on their own.
+/// </summary>
+inline void Nes::clockPPU() {
+    masterClock += PPU_CYCLES_PER_CPU_CYCLE;
+    if (!ppuCatchUp || masterClock > ppu_->m_nextEventClock) {
+        ppu_->CatchUp();
+    }
+}
+
+/// <summary>
+/// One CPU cycle of APU. The APU only really runs when the next audio sample is due
+/// or its IRQ could go up, register accesses catch it up on their own.
+/// </summary>
+inline void Nes::clockAPU() {
+    apu_->pending_cycles++;
+    if (--apuSyncIn == 0 || apu_->timing_changed) {
+        syncAPU();
+    }
+}
+
+/// <summary>
+/// Runs the APU up to the current cycle, takes the audio sample if this is the cycle it is due on,
+/// and works out when the next sync has to happen.
+/// </summary>
+void Nes::syncAPU() {
+    apu_->catch_up();
+
+    // The IRQ flag has to be up by the end of the cycle that sets it, the CPU looks at it next cycle
+    int64_t toIrq = (int64_t)apu_->cycles_until_irq() + 1;
+    if (apu_->blip) {
+        // The APU records its own output changes, only the IRQ needs it to be on time
+        if (apu_->blip_time + BLIP_MAX_SPAN > blip_->MaxFrameClocks()) {
+            // Nobody is ending audio frames, don't let the buffer fill up
+            flushAudio();
+        }
+        apuSyncSpan = (uint32_t)(std::min)((int64_t)BLIP_MAX_SPAN, toIrq);
+        apuSyncIn = apuSyncSpan;
+        apu_->timing_changed = false;
+        return;
+    }
+
+    // Generate audio sample based on cycle timing
+    audioFraction += apuSyncSpan - apuSyncIn;
+    while (audioFraction >= cyclesPerSample) {
+        audioBuffer.push_back(apu_->get_output());
+        audioFraction -= cyclesPerSample;
+    }
+
+    uint32_t toSample = (uint32_t)std::ceil(cyclesPerSample - audioFraction);
+    if (audioFraction + toSample < cyclesPerSample) {
+        toSample++;
+    }
+    apuSyncSpan = (uint32_t)(std::min)((int64_t)toSample, toIrq);
+    apuSyncIn = apuSyncSpan;
+    apu_->timing_changed = false;
 }
 
 /// <summary>
@@ -77,17 +149,8 @@ void Nes::clock() {
         bool irq_active = apu_->get_irq_flag() || cart_->mapper->IrqPending();
         cpu_->setIRQ(irq_active);
         cpu_->ConsumeCycle();
-        ppu_->Clock();
-        ppu_->Clock();
-        ppu_->Clock();
-        apu_->step();
-
-        // Generate audio sample based on cycle timing
-        audioFraction += 1.0;
-        while (audioFraction >= CYCLES_PER_SAMPLE) {
-            audioBuffer.push_back(apu_->get_output());
-            audioFraction -= CYCLES_PER_SAMPLE;
-        }
+        clockPPU();
+        clockAPU();
 
         if (dmaCycles == 0) {
             dmaActive = false;
@@ -100,48 +163,308 @@ void Nes::clock() {
         cpu_->setIRQ(irq_active);
         cpu_->cpu_tick();
 
-        ppu_->Clock();
-        ppu_->Clock();
-        ppu_->Clock();
-        apu_->step();
+        clockPPU();
+        clockAPU();
+
+        if (idleSkip && cpu_->inst_complete) {
+            checkIdleLoop();
+        }
+    }
+}
+
+/// <summary>
+/// Instruction-stepped alternative to clock(). Runs the CPU through a whole instruction
+/// (or a whole OAM DMA) and returns the number of CPU cycles it took.
+/// Each bus access is stamped with the CPU cycle it happens on. RAM and ROM go through the page
+/// table and never touch the other chips, anything else makes the Bus call syncDevices first,
+/// so the PPU/APU see the access at exactly the same cycle as they would in lockstep.
+/// </summary>
+int Nes::stepInstruction() {
+    uint64_t start = cpu_->GetCycleCount();
+    syncDevices();
+    if (dmaActive) {
+        // The DMA loop reads the bus every other cycle anyway, nothing to gain from batching it.
+        while (dmaActive) {
+            clock();
+        }
+        syncedCycle = cpu_->GetCycleCount();
+        return (int)(syncedCycle - start);
+    }
+    if (!cpu_->IsActive()) {
+        cpu_->ConsumeCycle();
+        syncDevices();
+        return 1;
+    }
+
+    // IRQ is sampled once per instruction instead of every cycle
+    cpu_->setIRQ(apu_->get_irq_flag() || cart_->mapper->IrqPending());
+    do {
+        cpu_->cpu_tick();
+    } while (!cpu_->inst_complete);
+    syncDevices();
+    if (idleSkip) {
+        checkIdleLoop();
+        syncedCycle = cpu_->GetCycleCount();
+    }
+    return (int)(cpu_->GetCycleCount() - start);
+}
+
+/// <summary>
+/// Called on every instruction boundary. A backward jump or branch marks a possible loop head.
+/// If we come back to the head with the same registers and nothing but RAM/ROM/PPUSTATUS reads
+/// in between, the next iteration would do exactly the same thing, so it is an idle loop.
+/// </summary>
+void Nes::checkIdleLoop() {
+    uint16_t pc = cpu_->GetPC();
+    uint64_t now = cpu_->GetCycleCount();
+    if (idleArmed && pc == idleHeadPC) {
+        uint64_t period = now - idleHeadCycle;
+        if (!bus_->idleSideEffect && period <= IDLE_MAX_PERIOD &&
+            cpu_->GetA() == idleA && cpu_->GetX() == idleX && cpu_->GetY() == idleY &&
+            cpu_->GetStatus() == idleP && cpu_->GetSP() == idleSP) {
+            skipIdleLoop((int)period);
+            now = cpu_->GetCycleCount();
+        }
+        armIdleLoop(pc, now);
+    }
+    else if (pc <= idlePrevPC) {
+        armIdleLoop(pc, now);
+    }
+    else if (idleArmed && now - idleHeadCycle > IDLE_MAX_PERIOD) {
+        idleArmed = false;
+    }
+    idlePrevPC = pc;
+}
+
+void Nes::armIdleLoop(uint16_t pc, uint64_t cycle) {
+    idleArmed = true;
+    idleHeadPC = pc;
+    idleHeadCycle = cycle;
+    idleA = cpu_->GetA();
+    idleX = cpu_->GetX();
+    idleY = cpu_->GetY();
+    idleP = cpu_->GetStatus();
+    idleSP = cpu_->GetSP();
+    bus_->idleSideEffect = false;
+    bus_->idleStatusRead = false;
+}
 
-        // Generate audio sample based on cycle timing
-        audioFraction += 1.0;
-        while (audioFraction >= CYCLES_PER_SAMPLE) {
-            audioBuffer.push_back(apu_->get_output());
-            audioFraction -= CYCLES_PER_SAMPLE;
+/// <summary>
+/// Runs the PPU/APU through as many whole iterations of the loop as fit before the next thing
+/// that could change what the loop sees: the next PPU event (VBlank/NMI, mapper IRQ edge, flags
+/// cleared at pre-render), or the APU frame IRQ when IRQs are enabled. The rest runs normally.
+/// </summary>
+void Nes::skipIdleLoop(int period) {
+    if (!ppuCatchUp || dmaActive || cpu_->IsDebuggerAttached() || !cpu_->InterruptsQuiet()) {
+        return;
+    }
+    syncAPU();
+    int64_t budget = INT64_MAX;
+    if (bus_->idleStatusRead) {
+        ppu_->CatchUp();
+        // An event between the last read and now (VBlank set, flags cleared at pre-render)
+        // means the next iteration reads something different and may leave the loop.
+        if (ppu_->GetPPUStatus() != ppu_->statusAfterRead) {
+            return;
         }
+        // Sprite 0 hit and overflow can change in the middle of a visible line, those are not events.
+        int scanline = ppu_->renderer->m_scanline;
+        bool rendering = (ppu_->m_ppuMask & 0x18) != 0;
+        if (rendering && scanline < 241) {
+            return;
+        }
+        if (rendering && scanline == 261) {
+            // Same for the visible lines coming up, so stop before the first one.
+            // The odd frame skip can make the line one dot shorter.
+            budget = (DOTS_PER_SCANLINE - ppu_->renderer->dot) / PPU_CYCLES_PER_CPU_CYCLE;
+        }
+    }
+    budget = (std::min)(budget, (int64_t)(ppu_->m_nextEventClock - masterClock) / PPU_CYCLES_PER_CPU_CYCLE);
+    if (!cpu_->GetFlag(FLAG_INTERRUPT)) {
+        if (apu_->get_irq_flag() || cart_->mapper->IrqPending()) {
+            return;
+        }
+        budget = (std::min)(budget, (int64_t)apu_->cycles_until_irq());
+    }
+    int64_t iterations = budget / period;
+    if (iterations <= 0) {
+        return;
     }
+    int64_t cycles = iterations * period;
+    for (int64_t i = 0; i < cycles; i++) {
+        cpu_->ConsumeCycle();
+        clockPPU();
+        clockAPU();
+    }
+    idleCyclesSkipped += cycles;
+}
+
+
+/// <summary>
+/// Brings the PPU and APU up to the CPU's current cycle. The PPU still only runs
+/// if one of its events falls inside the gap, the APU gets stepped for each missing cycle.
+/// </summary>
+void Nes::syncDevices() {
+    // The APU's DMC fetch can read the bus while we are in here.
+    if (syncing) return;
+    syncing = true;
+    uint64_t now = cpu_->GetCycleCount();
+    if (syncedCycle > now) {
+        // The CPU was power cycled underneath us
+        syncedCycle = now;
+    }
+    while (syncedCycle < now) {
+        syncedCycle++;
+        clockPPU();
+        clockAPU();
+    }
+    syncing = false;
+}
+
+void Nes::SetInstructionStepped(bool enabled) {
+    instructionStepped = enabled;
+    syncedCycle = cpu_->GetCycleCount();
+    bus_->stepSync = enabled ? this : nullptr;
 }
 
 bool Nes::frameReady() {
 	return ppu_->isFrameTicked();
 }
 
+void Nes::endAudioFrame() {
+    if (!apu_->blip) {
+        return;
+    }
+    syncAPU();
+    flushAudio();
+}
+
+/// <summary>
+/// Closes the band-limited frame at the APU's current cycle and appends
+/// every sample it completed to audioBuffer in one go.
+/// </summary>
+void Nes::flushAudio() {
+    blip_->EndFrame(apu_->blip_time);
+    apu_->blip_time = 0;
+    int count = blip_->SamplesAvailable();
+    size_t start = audioBuffer.size();
+    audioBuffer.resize(start + count);
+    blip_->ReadSamples(audioBuffer.data() + start, count);
+}
+
+void Nes::SetBandLimitedAudio(bool enabled) {
+    syncAPU();
+    if (apu_->blip) {
+        flushAudio();
+    }
+    bandLimitedAudio = enabled;
+    blip_->Clear();
+    apu_->blip = enabled ? blip_ : nullptr;
+    apu_->blip_time = 0;
+    apu_->blip_level = 0.0f;
+    audioFraction = 0.0;
+    syncAPU();
+}
+
+void Nes::SetAudioSampleRate(int rate) {
+    if (apu_->blip) {
+        endAudioFrame();
+    }
+    audioSampleRate = rate;
+    cyclesPerSample = CPU_FREQ / rate;
+    blip_->SetRates(CPU_FREQ, rate);
+    apu_->blip_level = 0.0f;
+}
+
 void Nes::Serialize(Serializer& serializer) {
+    // Bring the PPU up to date so the state is the same as the lockstep loop would save.
+    ppu_->CatchUp();
+    serializer.WriteHeader(cart_->romHash, STATE_REGION_NTSC);
+    serializer.BeginChunk(CHUNK_CPU);
     cpu_->Serialize(serializer);
+    serializer.EndChunk();
+    serializer.BeginChunk(CHUNK_PPU);
 	ppu_->Serialize(serializer);
+    serializer.EndChunk();
+    serializer.BeginChunk(CHUNK_RAM);
 	bus_->Serialize(serializer);
+    serializer.EndChunk();
+    syncAPU();
     SaveState data;
     data.dmaActive = dmaActive;
     data.dmaPage = dmaPage;
     data.dmaAddr = dmaAddr;
     data.dmaCycles = dmaCycles;
+    serializer.BeginChunk(CHUNK_DMA);
 	serializer.Write(data);
+    serializer.EndChunk();
+    // The mapper writes its own chunks, its RAM apart from its registers
 	cart_->mapper->Serialize(serializer);
+    serializer.BeginChunk(CHUNK_APU);
 	apu_->Serialize(serializer);
+    serializer.EndChunk();
 }
 
 void Nes::Deserialize(Serializer& serializer) {
+    HeaderState header = serializer.ReadHeader();
+    // Checked before anything is loaded, a state for another game leaves this one running
+    if (header.version != STATE_VERSION_UNCHUNKED && header.romHash != cart_->romHash) {
+        throw std::runtime_error("Save state is from another game");
+    }
+    if (header.region != STATE_REGION_NTSC) {
+        throw std::runtime_error("Save state is from another region");
+    }
+    // A missing part is found before anything is loaded
+    for (uint32_t tag : { CHUNK_CPU, CHUNK_PPU, CHUNK_RAM, CHUNK_DMA, CHUNK_APU }) {
+        serializer.RequireChunk(tag);
+        serializer.CloseChunk();
+    }
+    serializer.RequireChunk(CHUNK_CPU);
     cpu_->Deserialize(serializer);
+    serializer.CloseChunk();
+    serializer.RequireChunk(CHUNK_PPU);
 	ppu_->Deserialize(serializer);
+    serializer.CloseChunk();
+    serializer.RequireChunk(CHUNK_RAM);
 	bus_->Deserialize(serializer);
+    serializer.CloseChunk();
     SaveState data;
+    serializer.RequireChunk(CHUNK_DMA);
 	serializer.Read(data);
+    serializer.CloseChunk();
     dmaActive = data.dmaActive;
     dmaPage = data.dmaPage;
     dmaAddr = data.dmaAddr;
     dmaCycles = data.dmaCycles;
 	cart_->mapper->Deserialize(serializer);
+    serializer.RequireChunk(CHUNK_APU);
 	apu_->Deserialize(serializer);
+    serializer.CloseChunk();
+    apu_->pending_cycles = 0;
+    apuSyncIn = apuSyncSpan = 1;
+    syncedCycle = cpu_->GetCycleCount();
+}
+
+void Nes::SaveToBuffer(StateBuffer& buffer) {
+    Serializer serializer;
+    serializer.StartSerialization(buffer);
+    Serialize(serializer);
+}
+
+void Nes::LoadFromBuffer(const StateBuffer& buffer) {
+    Serializer serializer;
+    serializer.StartDeserialization(buffer.data(), buffer.size);
+    Deserialize(serializer);
+}
+
+void Nes::DeserializeOrRollBack(Serializer& serializer, StateBuffer& rollback) {
+    SaveToBuffer(rollback);
+    try {
+        Deserialize(serializer);
+    }
+    catch (const std::exception&) {
+        // A chunk that's too short, or a mapper's, only shows up once the ones before it are loaded
+        LoadFromBuffer(rollback);
+        throw;
+    }
 }
\ No newline at end of file
@@ -21,7 +21,9 @@ class ReadController1Mapper;
 class ReadController2Mapper;
 class OpenBusMapper;
 class Serializer;
+struct StateBuffer;
 class DebuggerContext;
+class BlipBuffer;
 
 class Nes
 {
@@ -43,7 +45,37 @@ public:
 	bool loadRom(const std::wstring& filepath);
 	void reset();
 	void clock();
+	int stepInstruction();
+	void syncDevices();
+	void SetInstructionStepped(bool enabled);
+	bool IsInstructionStepped() const { return instructionStepped; }
 	bool frameReady();
+	// Turns the APU's buffered deltas into samples on the end of audioBuffer.
+	// Call once per frame, does nothing when point sampling.
+	void endAudioFrame();
+	void SetBandLimitedAudio(bool enabled);
+	bool IsBandLimitedAudio() const { return bandLimitedAudio; }
+	void SetAudioSampleRate(int rate);
+
+	// Master clock in PPU dots (3 per CPU cycle). The PPU keeps its own timestamp
+	// and catches up to this one when needed.
+	uint64_t masterClock = 0;
+	// When set, the PPU only runs when something could observe it instead of 3 dots every CPU cycle.
+	// Pixels and timing are the same either way, lockstep is kept around for debugging.
+	bool ppuCatchUp = true;
+	// Instruction-stepped mode runs a whole CPU instruction per call. The PPU and APU are not
+	// clocked per cycle, the Bus syncs them up to the current CPU cycle right before any access
+	// that goes through the memory map (registers), and again at the end of the instruction.
+	// Interrupt lines are only sampled between instructions, so this is for bulk replay and testing,
+	// the per-cycle clock() stays the reference.
+	bool instructionStepped = false;
+	// The CPU cycle the PPU and APU have been brought up to in instruction-stepped mode
+	uint64_t syncedCycle = 0;
+	// Skip over loops that just wait for an interrupt (JMP *, LDA $2002 / BPL, polling a RAM flag).
+	// The loop is only skipped in whole iterations and never past the next PPU/APU event,
+	// so the CPU comes out of it on exactly the same cycle as if it had run.
+	bool idleSkip = true;
+	uint64_t idleCyclesSkipped = 0;
 
 	// OAM DMA
 	bool dmaActive;
@@ -53,6 +85,11 @@ public:
 
 	// Audio buffer for queueing samples
 	std::vector<float> audioBuffer;
+	int audioSampleRate = 44100;
+	// Band-limited synthesis from the APU's output changes. Off means the old
+	// point sampling of the mixed output every cyclesPerSample cycles.
+	bool bandLimitedAudio = true;
+	BlipBuffer* blip_;
 
 	Bus* bus_;
 	PPU* ppu_;
@@ -69,8 +106,41 @@ public:
 
 	void Serialize(Serializer& serializer);
 	void Deserialize(Serializer& serializer);
+	// Same state as Serialize() writes, kept in memory. Reusing the buffer makes this a few copies,
+	// cheap enough for rewind and run-ahead to take one every frame.
+	void SaveToBuffer(StateBuffer& buffer);
+	void LoadFromBuffer(const StateBuffer& buffer);
+	// For states from a file. One that turns out damaged partway through is undone, the machine is
+	// saved into rollback first and put back. LoadFromBuffer() skips that, its states are our own.
+	void DeserializeOrRollBack(Serializer& serializer, StateBuffer& rollback);
 
 private:
+	inline void clockPPU();
+	inline void clockAPU();
+	void syncAPU();
+	// Cycles left until the APU has to be synced, and the length of the current span
+	uint32_t apuSyncIn = 1;
+	uint32_t apuSyncSpan = 1;
+	bool syncing = false;
+	void flushAudio();
+	// Longest the APU is left behind in band-limited mode, it only has to catch up for the IRQ
+	static constexpr uint32_t BLIP_MAX_SPAN = 4096;
+
+	void checkIdleLoop();
+	void skipIdleLoop(int period);
+	void armIdleLoop(uint16_t pc, uint64_t cycle);
+	// Longest loop (in CPU cycles) we bother to look at
+	static constexpr int IDLE_MAX_PERIOD = 64;
+	bool idleArmed = false;
+	uint16_t idlePrevPC = 0;
+	uint16_t idleHeadPC = 0;
+	uint64_t idleHeadCycle = 0;
+	uint8_t idleA = 0;
+	uint8_t idleX = 0;
+	uint8_t idleY = 0;
+	uint8_t idleP = 0;
+	uint8_t idleSP = 0;
 
 	double audioFraction = 0.0;  // Per-frame fractional pos
+	double cyclesPerSample = CYCLES_PER_SAMPLE;
 };
\ No newline at end of file
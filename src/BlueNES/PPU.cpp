@@ -5,13 +5,18 @@
 #include "Bus.h"
 #include "Core.h"
 #include "RendererLoopy.h"
+#include "RendererScanline.h"
 #include "A12Mapper.h"
 #include "MapperBase.h"
 #include "Serializer.h"
 #include "DebuggerContext.h"
 #include "Mapper.h"
 #include <array>
+#include <fstream>
+#include <vector>
+#include <iterator>
 #include "Cartridge.h"
+#include "Nes.h"
 
 HWND m_hwnd;
 
@@ -20,10 +25,15 @@ PPU::PPU(SharedContext& ctx, Nes& nes) : context(ctx), nes(nes) {
 	oam.fill(0xFF);
 	m_ppuCtrl = 0;
 	oamAddr = 0;
+	ResetPalette();
 }
 
 PPU::~PPU()
 {
+	if (lineRenderer) {
+		delete lineRenderer;
+		lineRenderer = nullptr;
+	}
 	if (renderer) {
 		delete renderer;
 		renderer = nullptr;
@@ -33,6 +43,7 @@ PPU::~PPU()
 void PPU::initialize() {
 	renderer = new RendererLoopy(context);
 	renderer->initialize(this);
+	lineRenderer = new RendererScanline(*renderer, *this);
 }
 
 void PPU::set_hwnd(HWND hwnd) {
@@ -47,6 +58,8 @@ void PPU::reset()
 	ppuDataBuffer = 0;
 	paletteTable.fill(0x00);
 	renderer->reset();
+	m_clock = nes.masterClock;
+	ScheduleNextEvent();
 	clearBuffer(context.GetBackBuffer());
 	context.SwapBuffers();
 	clearBuffer(context.GetBackBuffer());
@@ -65,7 +78,10 @@ void PPU::step()
 }
 
 uint8_t PPU::read(uint16_t address) {
-	return read_register(0x2000 + (address & 0x7));
+	CatchUp();
+	uint8_t value = read_register(0x2000 + (address & 0x7));
+	ScheduleNextEvent(true);
+	return value;
 }
 
 uint8_t PPU::peek(uint16_t address) {
@@ -81,7 +97,9 @@ void PPU::register_memory(Bus& bus) {
 }
 
 void PPU::writeOAM(uint16_t addr, uint8_t val) {
+	CatchUp();
 	oam[addr] = val;
+	renderer->invalidateSprites();
 }
 
 void PPU::performDMA(uint8_t page)
@@ -95,12 +113,15 @@ void PPU::performDMA(uint8_t page)
 }
 
 void PPU::write(uint16_t address, uint8_t value) {
+	CatchUp();
 	if (address == 0x4014) {
 		performDMA(value);
 	}
 	else {
 		write_register(0x2000 + (address & 0x7), value);
 	}
+	// PPUCTRL/PPUMASK can move the next event
+	ScheduleNextEvent(true);
 }
 
 inline void PPU::write_register(uint16_t addr, uint8_t value)
@@ -131,6 +152,7 @@ inline void PPU::write_register(uint16_t addr, uint8_t value)
 	case OAMDATA:
 		LOG(L"(%d) 0x%04X OAMDATA Write 0x%02X\n", bus->cpu.GetCycleCount(), bus->cpu.GetPC(), value);
 		oam[oamAddr++] = value;
+		renderer->invalidateSprites();
 		break;
 	case PPUSCROLL:
 		LOG(L"(%d) 0x%04X PPUSCROLL Write 0x%02X\n", bus->cpu.GetCycleCount(), bus->cpu.GetPC(), value);
@@ -152,6 +174,7 @@ inline void PPU::write_register(uint16_t addr, uint8_t value)
 		renderer->ppuIncrementVramAddr(m_ppuCtrl & PPUCTRL_INCREMENT ? 32 : 1);
 		write_vram(vramAddr, value);
 		if (m_mapper) {
+			renderer->syncA12();
 			m_mapper->ClockIRQCounter(renderer->ppuGetVramAddr());
 		}
 		break;
@@ -186,6 +209,7 @@ inline uint8_t PPU::read_register(uint16_t addr)
 		uint8_t status = m_ppuStatus;
 		LOG(L"(%d) 0x%04X PPUSTATUS Read 0x%02X\n", bus->cpu.GetCycleCount(), bus->cpu.GetPC(), status);
 		m_ppuStatus &= ~PPUSTATUS_VBLANK;
+		statusAfterRead = m_ppuStatus;
 		return status;
 	}
 	case OAMADDR:
@@ -240,6 +264,7 @@ inline uint8_t PPU::read_register(uint16_t addr)
 			renderer->ppuIncrementVramAddr(m_ppuCtrl & PPUCTRL_INCREMENT ? 32 : 1); // increment v
 		}
 		if (m_mapper) {
+			renderer->syncA12();
 			m_mapper->ClockIRQCounter(renderer->ppuGetVramAddr());
 		}
 
@@ -326,6 +351,7 @@ uint8_t PPU::ReadVRAM(uint16_t addr) {
 		// Reading from CHR-ROM/RAM
 		value = bus->cart.mapper->readCHR(addr);
 		if (m_mapper) {
+			renderer->syncA12();
 			m_mapper->ClockIRQCounter(addr);
 		}
 	}
@@ -381,35 +407,82 @@ void PPU::write_vram(uint16_t addr, uint8_t value)
 }
 
 void PPU::UpdateState() {
-	dbgContext->ppuState.ctrl = m_ppuCtrl;
-	dbgContext->ppuState.mask = m_ppuMask;
-	dbgContext->ppuState.status = m_ppuStatus;
-	dbgContext->ppuState.scanline = renderer->m_scanline;
-	dbgContext->ppuState.dot = renderer->dot;
-	dbgContext->ppuState.bgPatternTableAddr = GetBackgroundPatternTableBase();
-	dbgContext->ppuState.spritePatternTableAddr = GetSpritePatternTableBase(0); // Pass 0 just to get the base address for 8x8 sprites
-	dbgContext->ppuState.scrollX = GetScrollX();
-	dbgContext->ppuState.scrollY = GetScrollY();
-	dbgContext->ppuState.mirrorMode = bus->cart.mapper->GetMirrorMode();
-	memcpy(dbgContext->ppuState.palette.data(), paletteTable.data(), 32);
-	memcpy(dbgContext->ppuState.oam.data(), oam.data(), 256);
-	int nametableCount = bus->cart.mapper->GetMirrorMode() == MapperBase::MirrorMode::FOUR_SCREEN ? 4 : 2;
-	memcpy(dbgContext->ppuState.nametables.data(), bus->cart.mapper->_vram.data(), 0x400 * nametableCount);
-	// TODO - CHR memory read may be slow depending on mapper implementation
-	// Consider memcpy by page?
-	for (int i = 0; i < 0x2000; i++) {
-		dbgContext->ppuState.chrMemory[i] = bus->cart.mapper->readCHR(i);
+	DebuggerContext::PPUState& state = dbgContext->BeginPPUSnapshot();
+	state.ctrl = m_ppuCtrl;
+	state.mask = m_ppuMask;
+	state.status = m_ppuStatus;
+	state.scanline = renderer->m_scanline;
+	state.dot = renderer->dot;
+	state.bgPatternTableAddr = GetBackgroundPatternTableBase();
+	state.spritePatternTableAddr = GetSpritePatternTableBase(0); // Pass 0 just to get the base address for 8x8 sprites
+	state.scrollX = GetScrollX();
+	state.scrollY = GetScrollY();
+	MapperBase* mapper = bus->cart.mapper;
+	state.mirrorMode = mapper->GetMirrorMode();
+	memcpy(state.palette.data(), paletteTable.data(), 32);
+	memcpy(state.oam.data(), oam.data(), 256);
+	int nametableCount = mapper->GetMirrorMode() == MapperBase::MirrorMode::FOUR_SCREEN ? 4 : 2;
+	memcpy(state.nametables.data(), mapper->_vram.data(), 0x400 * nametableCount);
+	// Straight out of the page table, readCHR() would also trip MMC2's latches
+	for (int page = 0; page < 0x20; page++) {
+		if (mapper->_ppuPages[page]) {
+			memcpy(&state.chrMemory[page << 8], mapper->_ppuPages[page], 0x100);
+		}
 	}
+	dbgContext->PublishPPUSnapshot();
 }
 
 void PPU::Clock() {
 	// TODO Make the scanline and dot configurable since banks or scrolling may change during the frame render.
-	if (renderer->m_scanline == 0 && renderer->dot == 0) {
+	// Only while a debug window wants it, nothing is copied otherwise.
+	if (renderer->m_scanline == 0 && renderer->dot == 0 && dbgContext->PPUSnapshotWanted()) {
 		UpdateState();
 	}
 	renderer->clock(buffer);
 }
 
+/// <summary>
+/// Runs the PPU up to the master clock. Everything before the current CPU cycle is done
+/// after this, which is exactly what the lockstep loop would have done by now.
+/// </summary>
+void PPU::CatchUp() {
+	uint64_t target = nes.masterClock;
+	if (m_clock >= target) {
+		return;
+	}
+	while (m_clock < target) {
+		if (m_scanlineRenderer && lineRenderer->canRenderLine() && target - m_clock >= (uint64_t)lineRenderer->dotsToLineEnd()) {
+			// Nothing can touch us before the end of the visible line, do the rest of it all at once
+			lineRenderer->renderLine(buffer);
+			continue;
+		}
+		if (target - m_clock >= 8 && renderer->canRenderTile()) {
+			// A whole tile with nothing able to write to us in the middle of it.
+			// The fetch is on the last of the 8 dots, so the clock has to be there already.
+			m_clock += 8;
+			renderer->renderTile(buffer);
+			continue;
+		}
+		// Bump first so GetCycleCount() lines up with lockstep while the dot runs.
+		m_clock++;
+		Clock();
+	}
+	ScheduleNextEvent();
+}
+
+void PPU::ScheduleNextEvent(bool afterRegisterAccess) {
+	m_nextEventClock = m_clock + renderer->dotsUntilNextEvent(afterRegisterAccess);
+}
+
+uint64_t PPU::GetCycleCount() const {
+	return CycleAtClock(m_clock);
+}
+
+uint64_t PPU::CycleAtClock(uint64_t clock) const {
+	// The CPU is ahead by however many dots we still owe it.
+	return bus->cpu.GetCycleCount() - (nes.masterClock - clock) / 3;
+}
+
 uint8_t PPU::get_tile_pixel_color_index(uint8_t tileIndex, uint8_t pixelInTileX, uint8_t pixelInTileY, bool isSprite, bool isSecondSprite)
 {
 	if (isSprite) {
@@ -453,10 +526,56 @@ void PPU::get_palette(uint8_t paletteIndex, std::array<uint32_t, 4>& colors)
 {
 	// Each palette consists of 4 colors, starting from 0x3F00 in VRAM
 	uint16_t paletteAddr = paletteIndex * 4;
-	colors[0] = m_nesPalette[paletteTable[paletteAddr] & 0x3F];
-	colors[1] = m_nesPalette[paletteTable[paletteAddr + 1] & 0x3F];
-	colors[2] = m_nesPalette[paletteTable[paletteAddr + 2] & 0x3F];
-	colors[3] = m_nesPalette[paletteTable[paletteAddr + 3] & 0x3F];
+	colors[0] = colorTable[paletteTable[paletteAddr] & 0x3F];
+	colors[1] = colorTable[paletteTable[paletteAddr + 1] & 0x3F];
+	colors[2] = colorTable[paletteTable[paletteAddr + 2] & 0x3F];
+	colors[3] = colorTable[paletteTable[paletteAddr + 3] & 0x3F];
+}
+
+void PPU::ResetPalette() {
+	uint8_t rgb[64 * 3];
+	for (int i = 0; i < 64; i++) {
+		rgb[i * 3] = (m_nesPalette[i] >> 16) & 0xFF;
+		rgb[i * 3 + 1] = (m_nesPalette[i] >> 8) & 0xFF;
+		rgb[i * 3 + 2] = m_nesPalette[i] & 0xFF;
+	}
+	SetPalette(rgb, 64);
+}
+
+bool PPU::LoadPalette(const std::string& path) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	std::vector<uint8_t> rgb((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	// Anything but 64 or 512 colors isn't a palette we know how to use
+	if (rgb.size() != 64 * 3 && rgb.size() != 512 * 3) {
+		return false;
+	}
+	SetPalette(rgb.data(), rgb.size() / 3);
+	return true;
+}
+
+/// <summary>
+/// Builds the color table from 64 or 512 RGB triplets. With only 64 the emphasis rows
+/// are made by attenuating the other two channels (standard NTSC attenuation is ~0.746).
+/// </summary>
+void PPU::SetPalette(const uint8_t* rgb, size_t colors) {
+	const float factor = 0.75f;
+	for (int emphasis = 0; emphasis < 8; emphasis++) {
+		for (int i = 0; i < 64; i++) {
+			const uint8_t* src = colors >= 512 ? &rgb[(emphasis * 64 + i) * 3] : &rgb[i * 3];
+			uint8_t r = src[0];
+			uint8_t g = src[1];
+			uint8_t b = src[2];
+			if (colors < 512) {
+				if (emphasis & 1) { g = (uint8_t)(g * factor); b = (uint8_t)(b * factor); } // Red: Darken G, B
+				if (emphasis & 2) { r = (uint8_t)(r * factor); b = (uint8_t)(b * factor); } // Green: Darken R, B
+				if (emphasis & 4) { r = (uint8_t)(r * factor); g = (uint8_t)(g * factor); } // Blue: Darken R, G
+			}
+			colorTable[emphasis * 64 + i] = (0xFFu << 24) | (r << 16) | (g << 8) | b;
+		}
+	}
 }
 
 // The difference between FrameComplete and FrameTick is that FrameComplete marks we are in VBlank.
@@ -468,6 +587,25 @@ bool PPU::isFrameComplete() {
 	return renderer->isFrameComplete();
 }
 
+void PPU::SetSkipOutput(bool skip) {
+	renderer->setSkipOutput(skip);
+}
+
+void PPU::SetIndexBuffer(uint16_t* buf) {
+	renderer->setIndexBuffer(buf);
+}
+
+uint16_t* PPU::GetIndexBuffer() const {
+	return renderer->getIndexBuffer();
+}
+
+void PPU::ConvertIndices(const uint16_t* indices, uint32_t* out, size_t count) const {
+	const uint32_t* colors = colorTable.data();
+	for (size_t i = 0; i < count; i++) {
+		out[i] = colors[indices[i] & 0x1FF];
+	}
+}
+
 bool PPU::isFrameTicked() {
 	return renderer->m_frameTick;
 }
@@ -490,6 +628,8 @@ inline void PPU::dbg(const wchar_t* fmt, ...) {
 }
 
 void PPU::Serialize(Serializer& serializer) {
+	// The mapper is saved after us, it has to have seen every fetch so far
+	renderer->syncA12();
 	renderer->Serialize(serializer);
 	PPUState state = {};
 	for (int i = 0; i < 0x100; i++) {
@@ -514,6 +654,7 @@ void PPU::Deserialize(Serializer& serializer) {
 	for (int i = 0; i < 0x100; i++) {
 		oam[i] = state.oam[i];
 	}
+	renderer->invalidateSprites();
 	oamAddr = state.oamAddr;
 	for (int i = 0; i < 32; i++) {
 		paletteTable[i] = state.paletteTable[i];
@@ -523,4 +664,7 @@ void PPU::Deserialize(Serializer& serializer) {
 	m_ppuCtrl = state.ppuCtrl;
 	
 	ppuDataBuffer = state.ppuDataBuffer;
+	// Saved states are always caught up
+	m_clock = nes.masterClock;
+	ScheduleNextEvent();
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <array>
 #include <utility>
+#include <string>
 #include "SharedContext.h"
 #include "MemoryMapper.h"
 
@@ -85,6 +86,7 @@ static constexpr uint32_t m_nesPalette[64] = {
 class Bus;
 class Core;
 class RendererLoopy;
+class RendererScanline;
 class A12Mapper;
 class Nes;
 class Serializer;
@@ -99,6 +101,7 @@ public:
 	void initialize();
 	void connectBus(Bus* bus) { this->bus = bus; }
 	RendererLoopy* renderer;
+	RendererScanline* lineRenderer = nullptr;
 	void reset();
 	void step();
 	uint8_t read(uint16_t address);
@@ -121,13 +124,38 @@ public:
 
 	std::array<uint8_t, 0x100> oam; // 256 bytes OAM (sprite memory)
 	uint8_t oamAddr;
+	// What a PPUSTATUS read would return if nothing happened since the last one (VBlank is cleared by reading).
+	// Idle loop skipping compares against it to see if the loop could now read something new.
+	uint8_t statusAfterRead = 0;
 	Bus* bus;
-	A12Mapper* m_mapper;
+	A12Mapper* m_mapper = nullptr;
 	Nes& nes;
 
 	void Clock();
+
+	// Catch-up scheduling. The PPU is allowed to run behind the CPU and only gets clocked
+	// when something could observe it: a register access, OAM DMA, a mapper write,
+	// or the next event deadline (VBlank/NMI, mapper A12 edge).
+	void CatchUp();
+	void ScheduleNextEvent(bool afterRegisterAccess = false);
+	// The CPU cycle the PPU is at. Same as cpu.GetCycleCount() when running lockstep.
+	uint64_t GetCycleCount() const;
+	// GetCycleCount() as it was when the PPU was at an earlier m_clock
+	uint64_t CycleAtClock(uint64_t clock) const;
+	uint64_t m_clock = 0; // Master clock timestamp of the PPU, in dots
+	uint64_t m_nextEventClock = 0; // Master clock at which the next event happens
 	
 	std::array<uint8_t, 32> paletteTable; // 32 bytes palette table
+	// Final ARGB colors: 8 emphasis rows (PPUMASK bits 5-7) of 64 colors each.
+	// Rebuilt only when the palette source changes, so rendering is a single lookup.
+	std::array<uint32_t, 512> colorTable;
+	const uint32_t* GetColorRow(uint8_t mask) const { return &colorTable[(mask & 0xE0) << 1]; }
+	void ResetPalette();
+	// .pal file with 64 RGB colors (emphasis is derived), or 512 with one set per emphasis combination
+	bool LoadPalette(const std::string& path);
+	void SetPalette(const uint8_t* rgb, size_t colors);
+	// Turns a palette-index frame (see SetIndexBuffer) into ARGB with the current color table.
+	void ConvertIndices(const uint16_t* indices, uint32_t* out, size_t count) const;
 	uint16_t GetVRAMAddress() const;
 	void SetVRAMAddress(uint16_t addr);
 	uint8_t GetPPUStatus() const { return m_ppuStatus; }
@@ -153,6 +181,18 @@ public:
 		}
 	}
 	void setBuffer(uint32_t* buf) { buffer = buf; }
+	// Frame-skip/headless: stop composing pixels from the next frame on, see RendererLoopy::setSkipOutput
+	void SetSkipOutput(bool skip);
+	// Whole visible lines at once when catching up over them (RendererScanline). Off leaves every line to
+	// RendererLoopy, the dot-accurate reference. Frames come out the same either way.
+	void SetScanlineRenderer(bool enabled) { m_scanlineRenderer = enabled; }
+	bool IsScanlineRenderer() const { return m_scanlineRenderer; }
+	// Emit 9-bit color table indices (6-bit color, 3-bit emphasis) into a 256x240 uint16_t buffer
+	// instead of ARGB. Half the memory of a frame, for recorders and bots that keep raw frames
+	// and only convert the ones they show. nullptr goes back to ARGB output.
+	void SetIndexBuffer(uint16_t* buf);
+	uint16_t* GetIndexBuffer() const;
+	// Publishes a snapshot for the debug windows, see DebuggerContext::RequestPPUSnapshot
 	void UpdateState();
 	bool isFrameTicked();
 
@@ -166,6 +206,7 @@ private:
 	bool is_failure = false;
 
 	uint8_t ppuDataBuffer = 0; // Internal buffer for PPUDATA reads
+	bool m_scanlineRenderer = true;
 
 	void write_vram(uint16_t addr, uint8_t value);
 	void performDMA(uint8_t page);
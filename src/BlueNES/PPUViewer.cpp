@@ -5,6 +5,7 @@
 #include "Nes.h"
 #include "imgui.h"
 #include "DebuggerContext.h"
+#include "RendererLoopy.h"
 
 void PPUViewer::CreateTexture(GLuint& id, int width, int height) {
     glGenTextures(1, &id);
@@ -172,19 +173,13 @@ void PPUViewer::UpdateCHRTexture(int bank, uint8_t palette_idx) {
 	_ppu->get_palette(palette_idx, palette);
     for (int tileY = 0; tileY < 16; tileY++) {
         for (int tileX = 0; tileX < 16; tileX++) {
-            uint16_t offset = (bank * 0x1000) + (tileY * 16 + tileX) * 16;
+            const uint8_t* tile = &_dbgContext->ppuState.chrMemory[(bank * 0x1000) + (tileY * 16 + tileX) * 16];
 
             for (int row = 0; row < 8; row++) {
-                uint8_t tile_l = _dbgContext->ppuState.chrMemory[offset + row];
-                uint8_t tile_h = _dbgContext->ppuState.chrMemory[offset + row + 8];
-
+                uint64_t rowPixels = RendererLoopy::DecodeTileRow(tile[row], tile[row + 8]);
                 for (int col = 0; col < 8; col++) {
-                    // Combine bits to get 0-3 color index
-                    uint8_t pixel = ((tile_l >> (7 - col)) & 0x01) |
-                        (((tile_h >> (7 - col)) & 0x01) << 1);
-
                     // Map color index to actual RGB (using a debug palette)
-                    uint32_t color = palette[pixel];
+                    uint32_t color = palette[(rowPixels >> (col * 8)) & 3];
                     pixels[(tileY * 8 + row) * 128 + (tileX * 8 + col)] = color | 0xFF000000;
                 }
             }
@@ -319,21 +314,14 @@ void PPUViewer::renderNametable(std::array<uint32_t, 256 * 240>& buffer, int phy
 void PPUViewer::render_tile(std::array<uint32_t, 256 * 240>& buffer,
     int pr, int pc, int tileIndex, std::array<uint32_t, 4>& colors) {
     
-    int tileOffset = tileIndex * 16; // 16 bytes per tile
     // Determine the pattern table base address
     uint16_t patternTableBase = _dbgContext->ppuState.bgPatternTableAddr;
+    const uint8_t* tile = &_dbgContext->ppuState.chrMemory[patternTableBase + tileIndex * 16];
 
     for (int y = 0; y < 8; y++) {
-        
-        int tileBase = patternTableBase + tileOffset; // 16 bytes per tile
-
-        uint8_t byte1 = _dbgContext->ppuState.chrMemory[tileBase + y];     // bitplane 0
-        uint8_t byte2 = _dbgContext->ppuState.chrMemory[tileBase + y + 8]; // bitplane 1
-
+        uint64_t rowPixels = RendererLoopy::DecodeTileRow(tile[y], tile[y + 8]);
         for (int x = 0; x < 8; x++) {
-            uint8_t bit0 = (byte1 >> (7 - x)) & 1;
-            uint8_t bit1 = (byte2 >> (7 - x)) & 1;
-            uint8_t colorIndex = (bit1 << 1) | bit0;
+            uint8_t colorIndex = (rowPixels >> (x * 8)) & 3;
 
             uint32_t actualColor = 0;
             if (colorIndex == 0) {
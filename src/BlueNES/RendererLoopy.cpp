@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <algorithm>
 #include "PPU.h"
 #include "A12Mapper.h"
 #include "Core.h"
@@ -26,6 +27,9 @@ void RendererLoopy::reset() {
     *(uint16_t*)&loopy.t = 0;
     loopy.x = 0;
     loopy.w = false;
+    m_spriteRowsDirty = true;
+    m_a12Level = -1;
+    m_a12Pending = false;
     memset(context.GetBackBuffer(), 0x00, WIDTH * HEIGHT * sizeof(uint32_t));
 }
 
@@ -86,6 +90,7 @@ void RendererLoopy::ppuWriteAddr(uint8_t value) {
 		// MMC3 IRQ handling: clock IRQ counter on PPUADDR write
         // "Should decrement when A12 is toggled via PPUADDR"
         if (m_ppu->m_mapper) {
+            syncA12();
             m_ppu->m_mapper->ClockIRQCounter(*t_ptr);
         }
     }
@@ -186,67 +191,51 @@ void RendererLoopy::renderPixelBackground(uint32_t* buffer) {
 
     //buffer[y * 256 + x] = 0xFF000000;
     uint8_t bgPaletteIndex = m_ppu->paletteTable[0];
-    uint32_t bgColor = m_nesPalette[bgPaletteIndex];
-    buffer[y * 256 + x] = bgColor;
+    writePixel(buffer, y * 256 + x, bgPaletteIndex);
 }
 
-inline void RendererLoopy::ApplyColorEmphasis(uint32_t& finalColor)
-{
-    // 4. Color Emphasis Implementation
-    // Bits 5, 6, 7 of PPUMASK: R, G, B (NTSC)
-    if (ppumask & 0xE0) {
-        // Extract RGB components (assuming 0xRRGGBB or 0xBBGGRR format)
-        // Adjust shifts based on your m_nesPalette format
-        uint8_t r = (finalColor >> 16) & 0xFF;
-        uint8_t g = (finalColor >> 8) & 0xFF;
-        uint8_t b = finalColor & 0xFF;
-
-        // Emphasis factor (standard NTSC attenuation is ~0.746)
-        const float factor = 0.75f;
+void RendererLoopy::renderPixel(uint32_t* buffer) {
+    int x = dot - 1; // visible pixel x [0..255]
+    int y = m_scanline; // pixel y [0..239]
 
-        if (ppumask & 0x20) { g = (uint8_t)(g * factor); b = (uint8_t)(b * factor); } // Red: Darken G, B
-        if (ppumask & 0x40) { r = (uint8_t)(r * factor); b = (uint8_t)(b * factor); } // Green: Darken R, B
-        if (ppumask & 0x80) { r = (uint8_t)(r * factor); g = (uint8_t)(g * factor); } // Blue: Darken R, G
+    // Determine whether or not to show the background in the leftmost 8 pixels of the screen.
+    bool bgShown = bgEnabled() && (dot > 8 || (ppumask & PPUMASK_BACKGRONDLEFT) != 0);
+    uint8_t pixel = bgShown ? get_pixel() : 0;
+    writePixel(buffer, y * 256 + x, composePixel(x, pixel, bgShown));
+}
 
-        finalColor = (0xFF << 24) | (r << 16) | (g << 8) | b;
+/// <summary>
+/// Stores a color table index, either as is or converted to ARGB, depending on the output mode.
+/// </summary>
+void RendererLoopy::writePixel(uint32_t* buffer, int offset, uint16_t index) {
+    if (m_indexBuffer) {
+        m_indexBuffer[offset] = index;
+    }
+    else {
+        buffer[offset] = m_ppu->colorTable[index];
     }
 }
 
-void RendererLoopy::renderPixel(uint32_t* buffer) {
-    int x = dot - 1; // visible pixel x [0..255]
-    int y = m_scanline; // pixel y [0..239]
-    
+/// <summary>
+/// Final color of pixel x on this scanline, given the background pixel (palette << 2 | color, 0 = transparent).
+/// Merges in the sprite line buffer, raises sprite 0 hit and applies grayscale and emphasis.
+/// Returns the index into the PPU color table, emphasis in bits 6-8.
+/// </summary>
+uint16_t RendererLoopy::composePixel(int x, uint8_t bgPixel, bool bgShown) {
     uint8_t bgPaletteIndex = m_ppu->paletteTable[0];
     bool bgOpaque = false;
-    // Determine whether or not to show the background in the leftmost 8 pixels of the screen.
-    if (bgEnabled() && (dot > 8 || (ppumask & PPUMASK_BACKGRONDLEFT) != 0)) {
-        uint8_t pixel = get_pixel();
-        bgPaletteIndex = m_ppu->paletteTable[pixel];
-        bgOpaque = pixel != 0;
-        if (ppumask & PPUMASK_GRAYSCALE) {
-            bgPaletteIndex &= 0x30; // Grayscale mode: only use bits 4 and 5 for color
-        }
+    // Grayscale mode: only use bits 4 and 5 for color
+    uint8_t grayMask = (ppumask & PPUMASK_GRAYSCALE) ? 0x30 : 0x3F;
+    if (bgShown) {
+        bgPaletteIndex = m_ppu->paletteTable[bgPixel] & grayMask;
+        bgOpaque = bgPixel != 0;
     }
 
-    // Sprite pixel (simplified): we check secondaryOAM sprites for an opaque pixel at current x
-	uint8_t spritePaletteIndex = 0;
-	uint32_t spriteColor = 0;
-	bool spriteOpaque = false;
-	bool spritePriorityBehind = false;
-	bool spriteIsZero = false;
-
     uint8_t finalIdx = bgPaletteIndex;
-    if (spriteEnabled() && (dot > 8 || (ppumask & PPUMASK_SPRITELEFT) != 0)) {
-        bool useSprite = false;
-
-        const auto& spr = spriteLineBuffer[x];
-        if (spr.valid) {  // There's a sprite pixel here
-            uint8_t palIdx = spr.palette + 4;
-            uint8_t sprIdx = m_ppu->paletteTable[0x10 + (spr.palette << 2) + spr.colorIndex];
-            if (ppumask & PPUMASK_GRAYSCALE) {
-                sprIdx &= 0x30; // Grayscale mode: only use bits 4 and 5 for color
-            }
-            uint32_t sprColor = m_nesPalette[sprIdx];
+    if (spriteEnabled() && (x >= 8 || (ppumask & PPUMASK_SPRITELEFT) != 0)) {
+        if (hasSpritePixel(x)) {  // There's a sprite pixel here
+            const auto& spr = spriteLineBuffer[x];
+            uint8_t sprIdx = m_ppu->paletteTable[0x10 + (spr.palette << 2) + spr.colorIndex] & grayMask;
 
             if (spr.isZero && bgOpaque && !hasSprite0HitBeenSet && x < 255) {
                 hasSprite0HitBeenSet = true;
@@ -255,16 +244,109 @@ void RendererLoopy::renderPixel(uint32_t* buffer) {
 
             if (!spr.behindBg || !bgOpaque) {
 				finalIdx = sprIdx;
-                useSprite = true;
             }
         }
     }
 
-	uint32_t finalColor = m_nesPalette[finalIdx];
+    // Emphasis picks the row of the color table
+    return (uint16_t)(((ppumask & 0xE0) << 1) | finalIdx);
+}
 
-    ApplyColorEmphasis(finalColor);
+// Each bit of a pattern byte spread out to its own byte, leftmost pixel (bit 7) in the lowest byte.
+// Lets a whole tile row be decoded with a few loads and ORs instead of 8 mask tests per plane.
+static const std::array<uint64_t, 256> s_bitSpread = [] {
+    std::array<uint64_t, 256> table{};
+    for (int value = 0; value < 256; value++) {
+        for (int bit = 0; bit < 8; bit++) {
+            if (value & (0x80 >> bit)) {
+                table[value] |= 1ull << (bit * 8);
+            }
+        }
+    }
+    return table;
+}();
 
-    buffer[y * 256 + x] = finalColor;
+uint64_t RendererLoopy::DecodeTileRow(uint8_t low, uint8_t high) {
+    return s_bitSpread[low] | (s_bitSpread[high] << 1);
+}
+
+/// <summary>
+/// Same as 8 calls to clock() starting on the first dot of a tile: 8 pixels out of the shift
+/// registers, then the fetch for the tile after next. Fine X is just where in the 16 bit
+/// registers the 8 pixels start, so all of them are decoded at once.
+/// </summary>
+void RendererLoopy::renderTile(uint32_t* buffer) {
+    int x0 = dot - 1;
+    int offset = m_scanline * 256 + x0;
+    uint64_t pixels = tilePixels();
+
+    bool bgShownLeft = bgEnabled() && (ppumask & PPUMASK_BACKGRONDLEFT) != 0;
+    bool bgShown = x0 >= 8 ? bgEnabled() : bgShownLeft;
+    if (m_indexBuffer) {
+        uint16_t* out = m_indexBuffer + offset;
+        for (int i = 0; i < 8; i++) {
+            uint8_t pixel = bgShown ? (uint8_t)(pixels >> (i * 8)) : 0;
+            out[i] = composePixel(x0 + i, pixel, bgShown);
+        }
+    }
+    else {
+        uint32_t* out = buffer + offset;
+        const uint32_t* colors = m_ppu->colorTable.data();
+        for (int i = 0; i < 8; i++) {
+            uint8_t pixel = bgShown ? (uint8_t)(pixels >> (i * 8)) : 0;
+            out[i] = colors[composePixel(x0 + i, pixel, bgShown)];
+        }
+    }
+    advanceTile();
+}
+
+/// <summary>
+/// The next 8 background pixels as get_pixel() would return them, leftmost in the lowest byte.
+/// </summary>
+uint64_t RendererLoopy::tilePixels() const {
+    int shift = 8 - loopy.x;
+    uint64_t pixels = DecodeTileRow((m_shifts.pattern_lo_shift >> shift) & 0xFF, (m_shifts.pattern_hi_shift >> shift) & 0xFF);
+    uint64_t attrLo = s_bitSpread[(m_shifts.attr_lo_shift >> shift) & 0xFF];
+    uint64_t attrHi = s_bitSpread[(m_shifts.attr_hi_shift >> shift) & 0xFF];
+    // Transparent pixels are 0 whatever their palette, same as get_pixel()
+    uint64_t opaque = ((pixels | (pixels >> 1)) & 0x0101010101010101ull) * 0xFF;
+    return (pixels | (attrLo << 2) | (attrHi << 3)) & opaque;
+}
+
+/// <summary>
+/// Everything but the pixels for the 8 dots of a tile: shift the registers along, fetch the tile
+/// after next on the last dot and step coarse X (and fine Y at the end of the line).
+/// </summary>
+void RendererLoopy::advanceTile() {
+    m_shifts.pattern_lo_shift <<= 8;
+    m_shifts.pattern_hi_shift <<= 8;
+    m_shifts.attr_lo_shift <<= 8;
+    m_shifts.attr_hi_shift <<= 8;
+    dot += 7;
+    fetch_tile_data(&tile, m_ppu->GetBackgroundPatternTableBase() == 0x1000 ? 1 : 0);
+    load_shift_registers();
+    ppuIncrementX();
+    if (dot == 256) ppuIncrementFineY();
+    dot++;
+}
+
+/// <summary>
+/// The part of renderPixel the CPU can observe, for frames that aren't being output.
+/// Only a sprite 0 pixel over an opaque background pixel matters, so the colors are never looked up.
+/// </summary>
+void RendererLoopy::checkSprite0Hit() {
+    int x = dot - 1;
+    if (!hasSpritePixel(x) || !spriteLineBuffer[x].isZero || x == 255 || !bgEnabled() || !spriteEnabled()) {
+        return;
+    }
+    // Left 8 pixels need both the background and sprites shown there
+    if (dot <= 8 && (ppumask & (PPUMASK_BACKGRONDLEFT | PPUMASK_SPRITELEFT)) != (PPUMASK_BACKGRONDLEFT | PPUMASK_SPRITELEFT)) {
+        return;
+    }
+    if (get_pixel() != 0) {
+        hasSprite0HitBeenSet = true;
+        m_ppu->SetPPUStatus(0x40);
+    }
 }
 
 uint16_t RendererLoopy::get_attribute_address(LoopyRegister& regV) {
@@ -280,7 +362,45 @@ uint8_t RendererLoopy::get_attribute_byte() {
     
     // Apply mirroring
     //attr_addr = m_bus->cart->MirrorNametable(attr_addr);
-    return m_ppu->ReadVRAM(attr_addr);
+    return readNametable(attr_addr);
+}
+
+inline uint8_t RendererLoopy::readNametable(uint16_t addr) {
+    addr = 0x2000 + (addr & 0x0FFF); // Mirror nametables every 4KB
+    return m_bus->cart.mapper->_ppuPages[addr >> 8][addr & 0xFF];
+}
+
+inline uint8_t RendererLoopy::readPattern(uint16_t addr) {
+    MapperBase* mapper = m_bus->cart.mapper;
+    uint8_t value = mapper->_watchesChrReads ? mapper->readCHR(addr) : mapper->_ppuPages[addr >> 8][addr & 0xFF];
+    if (m_mapper) {
+        notifyA12(addr);
+    }
+    return value;
+}
+
+inline void RendererLoopy::notifyA12(uint16_t addr) {
+    int8_t level = (addr & 0x1000) ? 1 : 0;
+    if (level == m_a12Level && m_a12Batching) {
+        // Another low fetch changes nothing, another high one only moves when the low time starts
+        if (level) {
+            m_a12Pending = true;
+            m_a12PendingAddr = addr;
+            m_a12PendingClock = m_ppu->m_clock;
+        }
+        return;
+    }
+    syncA12();
+    m_mapper->ClockIRQCounter(addr);
+    m_a12Level = level;
+}
+
+void RendererLoopy::syncA12() {
+    if (m_a12Pending) {
+        m_a12Pending = false;
+        m_mapper->ClockIRQCounterAt(m_a12PendingAddr, m_ppu->CycleAtClock(m_a12PendingClock));
+    }
+    m_a12Level = -1;
 }
 
 // Get palette index from attribute byte
@@ -297,7 +417,7 @@ uint8_t RendererLoopy::get_palette_from_attribute(uint8_t attr, uint8_t coarse_x
 void RendererLoopy::fetch_tile_data(TileFetch* tile, uint8_t pattern_table_base) {
     // 1. Fetch nametable byte (tile index)
     uint16_t nametable_addr = 0x2000 | (*(uint16_t*)&loopy.v & 0x0FFF);
-    tile->nametable_byte = m_ppu->ReadVRAM(nametable_addr);
+    tile->nametable_byte = readNametable(nametable_addr);
 
     // TODO 2. Fetch attribute byte
     tile->attribute_byte = get_attribute_byte();
@@ -307,10 +427,10 @@ void RendererLoopy::fetch_tile_data(TileFetch* tile, uint8_t pattern_table_base)
     uint16_t pattern_addr = (pattern_table_base << 12) |
         (tile->nametable_byte << 4) |
         loopy.v.fine_y;
-    tile->pattern_low = m_ppu->ReadVRAM(pattern_addr);
+    tile->pattern_low = readPattern(pattern_addr);
 
     // 4. Fetch pattern table high byte (+8 bytes from low)
-    tile->pattern_high = m_ppu->ReadVRAM(pattern_addr + 8);
+    tile->pattern_high = readPattern(pattern_addr + 8);
 }
 
 // Load fetched tile into shift registers
@@ -373,7 +493,10 @@ void RendererLoopy::clock(uint32_t* buffer) {
     if (rendering) {
         // Visible Pixel area
         if (dot <= 256) {
-            if (visibleScanline) renderPixel(buffer);
+            if (visibleScanline) {
+                if (!m_skipOutput) renderPixel(buffer);
+                else if (!hasSprite0HitBeenSet) checkSprite0Hit();
+            }
             shift_registers();
 
             // Combined dot checks.
@@ -403,7 +526,7 @@ void RendererLoopy::clock(uint32_t* buffer) {
         else if (dot == 257) {
             ppuCopyX();
             evaluateSprites(m_scanline, secondaryOAM);
-            spriteLineBuffer.fill({ 255, 0, 0, false, false, false });  // 255 = no sprite
+            m_spriteCoverage.fill(0);
             prepareSpriteLine(m_scanline);
         }
         else if (dot >= 258 && dot <= 320) {
@@ -416,7 +539,7 @@ void RendererLoopy::clock(uint32_t* buffer) {
 	}
     else {
         // Rendering is OFF
-        if (visibleScanline && dot <= 256) renderPixelBackground(buffer);
+        if (visibleScanline && dot <= 256 && !m_skipOutput) renderPixelBackground(buffer);
     }
     
     // 4. Pre-render Line specific state clear
@@ -426,6 +549,7 @@ void RendererLoopy::clock(uint32_t* buffer) {
         m_ppu->m_ppuStatus &= 0x1F; // Clear VBlank, sprite 0 hit, and sprite overflow
         m_frameComplete = false;
         m_bus->cpu.setNMI(false);
+        m_skipOutput = m_skipOutputRequest;
         }
 
     // 5. Odd frame skip
@@ -444,39 +568,153 @@ void RendererLoopy::clock(uint32_t* buffer) {
     }
 }
 
+/// <summary>
+/// How many dots can run before the CPU could notice something the renderer did.
+/// The catch-up scheduler in PPU uses this as its deadline. Coming in early is fine, it only
+/// costs an extra catch-up. Coming in late is not.
+/// </summary>
+int RendererLoopy::dotsUntilNextEvent(bool afterRegisterAccess) {
+    constexpr int dotsPerLine = DOTS_PER_SCANLINE + 1;
+    // One short of a full frame so the odd frame skip can never make us late.
+    constexpr int dotsPerFrame = (SCANLINES_PER_FRAME + 1) * dotsPerLine - 1;
+    const int now = m_scanline * dotsPerLine + dot;
+    int next = dotsPerFrame;
+    auto consider = [&](int scanline, int eventDot) {
+        int delta = scanline * dotsPerLine + eventDot - now;
+        if (delta < 0) delta += dotsPerFrame;
+        if (delta < next) next = delta;
+    };
+
+    // VBlank flag + NMI, and the pre-render line clearing them again.
+    consider(241, 1);
+    consider(261, 1);
+
+    // The mapper watches A12 on pattern fetches and can raise an IRQ on a rising edge.
+    // Pattern tables only change on register writes (which reschedule), so outside of those
+    // an edge can only happen where background and sprite fetches hand over to each other:
+    // the first background fetch (8), the first sprite fetch (261) and the prefetch (328).
+    // In 8x16 mode every sprite slot picks its own table.
+    if (m_mapper && renderingEnabled()) {
+        int nextLine = m_scanline < 239 ? m_scanline + 1 : (m_scanline == 261 ? 0 : 261);
+        for (int line : { m_scanline, nextLine }) {
+            if (line >= 240 && line != 261) continue;
+            consider(line, 8);
+            consider(line, 261);
+            if (m_ppu->m_ppuCtrl & PPUCTRL_SPRITESIZE) {
+                for (int slot = 1; slot < 8; slot++) {
+                    consider(line, 261 + slot * 8);
+                }
+            }
+            consider(line, 328);
+        }
+        // A register access may have just switched tables or moved A12 through PPUADDR/PPUDATA,
+        // so the very next fetch could be an edge too.
+        if (afterRegisterAccess && (m_scanline < 240 || m_scanline == 261)) {
+            if (dot <= 256) {
+                consider(m_scanline, (dot + 7) & ~7);
+            }
+            else if (dot <= 320) {
+                // Sprite pattern fetches are on steps 4 and 6 of each 8 dot slot.
+                int slotStart = 257 + ((dot - 257) / 8) * 8;
+                consider(m_scanline, dot <= slotStart + 4 ? slotStart + 4 : slotStart + 6);
+            }
+        }
+    }
+    return next;
+}
+
+/// <summary>
+/// Rebuilds the per-scanline list of sprites in range. Sprites below the screen (Y > $F0) never show up.
+/// </summary>
+void RendererLoopy::buildSpriteRows(int spriteHeight) {
+    m_spriteRows.fill(0);
+    for (int i = 0; i < 64; ++i) {
+        int spriteY = m_ppu->oam[i * 4];
+        if (spriteY > 0xF0) {
+            continue; // Empty sprite slot
+        }
+        int last = (std::min)(spriteY + spriteHeight, 256);
+        for (int row = spriteY; row < last; ++row) {
+            m_spriteRows[row] |= 1ull << i;
+        }
+    }
+    m_spriteRowsHeight = spriteHeight;
+    m_spriteRowsDirty = false;
+}
+
 void RendererLoopy::evaluateSprites(int screenY, std::array<Sprite, 8>& newOam) {
     for (int i = 0; i < 8; ++i) {
         newOam[i] = { 0xFF, 0xFF, 0xFF, 0xFF }; // Initialize to empty sprite
     }
-    // Evaluate sprites for this scanline
+    int spriteHeight = (m_ppu->m_ppuCtrl & PPUCTRL_SPRITESIZE) == 0 ? 8 : 16;
+    if (m_spriteRowsDirty || spriteHeight != m_spriteRowsHeight) {
+        buildSpriteRows(spriteHeight);
+    }
+    if (screenY >= 256) {
+        return; // Pre-render line, nothing can be in range
+    }
+    // Evaluate sprites for this scanline, lowest OAM index first
+    uint64_t inRange = m_spriteRows[screenY];
     int spriteCount = 0;
-    for (int i = 0; i < 64; ++i) {
-        int spriteY = m_ppu->oam[i * 4]; // Y position of the sprite
-        if (spriteY > 0xF0) {
-            continue; // Empty sprite slot
+    for (int i = 0; inRange != 0; ++i, inRange >>= 1) {
+        if ((inRange & 1) == 0) {
+            continue;
+        }
+        if (spriteCount < 8) {
+            // Copy sprite data to new OAM
+            newOam[spriteCount].y = m_ppu->oam[i * 4];
+            newOam[spriteCount].tileIndex = m_ppu->oam[i * 4 + 1];
+            newOam[spriteCount].attributes = m_ppu->oam[i * 4 + 2];
+            newOam[spriteCount].x = m_ppu->oam[i * 4 + 3];
+            newOam[spriteCount].isSprite0 = (i == 0); // Mark if this is sprite 0
+            spriteCount++;
         }
-        int spriteHeight = (m_ppu->m_ppuCtrl & PPUCTRL_SPRITESIZE) == 0 ? 8 : 16;
-        if (screenY >= spriteY && screenY < (spriteY + spriteHeight)) {
-            if (spriteCount < 8) {
-                // Copy sprite data to new OAM
-                newOam[spriteCount].y = m_ppu->oam[i * 4];
-                newOam[spriteCount].tileIndex = m_ppu->oam[i * 4 + 1];
-                newOam[spriteCount].attributes = m_ppu->oam[i * 4 + 2];
-                newOam[spriteCount].x = m_ppu->oam[i * 4 + 3];
-                newOam[spriteCount].isSprite0 = (i == 0); // Mark if this is sprite 0
-                spriteCount++;
+        else {
+            // Sprite overflow - more than 8 sprites on this scanline
+            if (!hasOverflowBeenSet) {
+                // Set sprite overflow flag only once per frame
+                hasOverflowBeenSet = true;
+                m_ppu->m_ppuStatus |= PPUSTATUS_SPRITE_OVERFLOW;
             }
-            else {
-                // Sprite overflow - more than 8 sprites on this scanline
-                if (!hasOverflowBeenSet) {
-                    // Set sprite overflow flag only once per frame
-                    hasOverflowBeenSet = true;
-                    m_ppu->m_ppuStatus |= PPUSTATUS_SPRITE_OVERFLOW;
-                }
-                break;
+            break;
+        }
+    }
+}
+
+// Pattern byte with its bits in reverse order, so bit n is the nth pixel from the left
+static const std::array<uint8_t, 256> s_bitReverse = [] {
+    std::array<uint8_t, 256> table{};
+    for (int value = 0; value < 256; value++) {
+        for (int bit = 0; bit < 8; bit++) {
+            if (value & (1 << bit)) {
+                table[value] |= 0x80 >> bit;
             }
         }
     }
+    return table;
+}();
+
+/// <summary>
+/// Coverage bits for pixels x..x+7, pixel x in bit 0. Pixels past the right edge read as covered.
+/// </summary>
+inline uint32_t RendererLoopy::spriteCoverage8(int x) const {
+    int word = x >> 6;
+    int bit = x & 63;
+    uint64_t bits = m_spriteCoverage[word] >> bit;
+    if (bit > 56) {
+        // Straddles two words, or runs off the end of the line
+        bits |= word < 3 ? m_spriteCoverage[word + 1] << (64 - bit) : ~0ull << (64 - bit);
+    }
+    return (uint32_t)bits & 0xFF;
+}
+
+inline void RendererLoopy::setSpriteCoverage8(int x, uint32_t bits) {
+    int word = x >> 6;
+    int bit = x & 63;
+    m_spriteCoverage[word] |= (uint64_t)bits << bit;
+    if (bit > 56 && word < 3) {
+        m_spriteCoverage[word + 1] |= (uint64_t)bits >> (64 - bit);
+    }
 }
 
 // Converting into a state machine
@@ -499,8 +737,8 @@ void RendererLoopy::prepareSpriteLine(int y) {
     case 1: // Garbage NT Read
     case 2: // Garbage AT Read
     case 3: // Garbage AT Read
-        // Hardware performs dummy reads here, usually to NT/AT 
-        m_ppu->ReadVRAM(0x2000 | s.tileIndex);
+        // Hardware performs dummy reads here, usually to NT/AT.
+        // Nametable reads don't do anything on the mappers we have, so there is nothing to read.
         break;
 
     case 4: { // Fetch Pattern Low Byte
@@ -533,7 +771,7 @@ void RendererLoopy::prepareSpriteLine(int y) {
 
             spritePatternAddrLow[slot] = bank + (tileId * 16) + row;
         }
-        spritePatternTableLow[slot] = m_ppu->ReadVRAM(spritePatternAddrLow[slot]);
+        spritePatternTableLow[slot] = readPattern(spritePatternAddrLow[slot]);
     } break;
 
     case 5: // Read Pattern Low Byte (Cycle 2)
@@ -543,44 +781,34 @@ void RendererLoopy::prepareSpriteLine(int y) {
     case 6: { // Fetch Pattern High Byte
         // THIS accesses 0x1000 range + 8 bytes
         spritePatternAddrHigh[slot] = spritePatternAddrLow[slot] + 8;
-        spritePatternTableHigh[slot] = m_ppu->ReadVRAM(spritePatternAddrHigh[slot]);
+        spritePatternTableHigh[slot] = readPattern(spritePatternAddrHigh[slot]);
     } break;
 
     case 7: { // Read Pattern High Byte (Cycle 2)
         // Ensure we read the RAM first due to IRQ timing issues, cycle accuracy (needs work!), etc.
         if (s.y >= 0xF0) return;
+        // Nobody looks at the other sprites' pixels when the frame isn't output
+        if (m_skipOutput && !s.isSprite0) return;
 
-        int spriteY = s.y;
-        int relY = y - spriteY;
-        //if (relY < 0 || relY >= (spriteHeight)) continue;
-
-        bool flipV = s.attributes & 0x80;
-        bool flipH = s.attributes & 0x40;
         uint8_t palette = s.attributes & 0x03;
         bool behind = s.attributes & 0x20;
+        // Put the leftmost pixel in bit 0
+        uint8_t low = spritePatternTableLow[slot];
+        uint8_t high = spritePatternTableHigh[slot];
+        if (!(s.attributes & 0x40)) {
+            low = s_bitReverse[low];
+            high = s_bitReverse[high];
+        }
 
-        if (flipV) relY = (spriteHeight - 1) - relY;
-
-        // We cache the next line of sprite pixels into a line buffer for quick access during pixel rendering
-        for (int x = 0; x < 8; ++x) {
-            int screenX = s.x + x;
-            if (screenX >= 256) break;
-
-            int bit = flipH ? x : (7 - x);
-            uint8_t color = ((spritePatternTableHigh[slot] >> bit) & 1) << 1 |
-                ((spritePatternTableLow[slot] >> bit) & 1);
-
-            if (color != 0) {  // Only overwrite if opaque
-                if (spriteLineBuffer[screenX].x == 255 || slot == 0) {  // First in priority
-                    spriteLineBuffer[screenX] = {
-                        (uint8_t)screenX,
-                        color,
-                        palette,
-                        behind,
-                        s.isSprite0 && color != 0,
-                        true
-                    };
-                }
+        // We cache the next line of sprite pixels into a line buffer for quick access during pixel rendering.
+        // Slots are done in priority order, so only opaque pixels no earlier sprite has covered get written.
+        uint32_t fresh = (low | high) & ~spriteCoverage8(s.x);
+        if (fresh == 0) return;
+        setSpriteCoverage8(s.x, fresh);
+        for (int x = 0; fresh != 0; ++x, fresh >>= 1) {
+            if (fresh & 1) {
+                uint8_t color = (((high >> x) & 1) << 1) | ((low >> x) & 1);
+                spriteLineBuffer[s.x + x] = { color, palette, behind, s.isSprite0 };
             }
         }
     } break;
@@ -626,6 +854,8 @@ void RendererLoopy::Serialize(Serializer& serializer) {
 }
 
 void RendererLoopy::Deserialize(Serializer& serializer) {
+    m_a12Level = -1;
+    m_a12Pending = false;
 	RendererState state;
 	serializer.Read(state);
 	m_scanline = state.m_scanline;
@@ -14,6 +14,8 @@ class Serializer;
 
 class RendererLoopy
 {
+    // Renders whole lines out of the same state, see RendererScanline.h
+    friend class RendererScanline;
 public:
     // Sprite data for current scanline
     typedef struct Sprite {
@@ -69,8 +71,8 @@ public:
         uint8_t pattern_high;    // High bit plane
     } TileFetch;
 
-    PPURegisters loopy;
-    ShiftRegisters m_shifts;
+    PPURegisters loopy{};
+    ShiftRegisters m_shifts{};
 
     RendererLoopy(SharedContext& ctx);
     void initialize(PPU* ppu);
@@ -90,14 +92,44 @@ public:
     uint16_t ppuGetVramAddr();
     void ppuIncrementVramAddr(uint8_t increment);
     void clock(uint32_t* buffer);
+    // Runs 8 visible dots (one background tile) in one go. Only valid when canRenderTile() says so,
+    // the owner has to have all 8 dots to give, since nothing can touch the PPU in between.
+    void renderTile(uint32_t* buffer);
+    bool canRenderTile() const {
+        return m_tileSpans && m_scanline < 240 && (dot & 7) == 1 && dot <= 249 && renderingEnabled() && !m_skipOutput;
+    }
+    // Whole-tile rendering for catch-up runs. Off means every dot goes through clock(), for comparison.
+    bool m_tileSpans = true;
+    int dotsUntilNextEvent(bool afterRegisterAccess);
     bool isFrameComplete() { return m_frameComplete; }
     void setFrameComplete(bool complete) { m_frameComplete = complete; }
     uint16_t get_attribute_address(LoopyRegister& regV);
 
     void setMapper(A12Mapper* mapper) {
         m_mapper = mapper;
+        m_a12Level = -1;
+        m_a12Pending = false;
     }
+    // Hands any held back A12 fetch to the mapper. Call before anything else clocks its IRQ counter.
+    void syncA12();
+    // Holding back A12 fetches the mapper can't tell apart. Off means every fetch is passed on, for comparison.
+    bool m_a12Batching = true;
     bool m_frameTick = false;
+    // No-output mode for fast-forward and headless runs. Pixels are not composed and the
+    // framebuffer is left alone, but everything the CPU can see (sprite 0 hit, overflow,
+    // VBlank/NMI, pattern fetches for A12) still happens on the same dot.
+    // Takes effect from the next pre-render line so a frame is never half drawn.
+    void setSkipOutput(bool skip) { m_skipOutputRequest = skip; }
+    bool isSkippingOutput() const { return m_skipOutput; }
+    // OAM was written, the per-scanline sprite lists have to be rebuilt before the next evaluation
+    void invalidateSprites() { m_spriteRowsDirty = true; }
+    // Palette-index output. When set, pixels go here as (emphasis << 6) | color, an index
+    // into PPU::colorTable, instead of ARGB into the frame buffer. nullptr goes back to ARGB.
+    void setIndexBuffer(uint16_t* indexBuffer) { m_indexBuffer = indexBuffer; }
+    uint16_t* getIndexBuffer() const { return m_indexBuffer; }
+
+    // One row of a tile as 8 color indices (0-3), one per byte, leftmost pixel in the lowest byte
+    static uint64_t DecodeTileRow(uint8_t low, uint8_t high);
 
     void Serialize(Serializer& serializer);
 	void Deserialize(Serializer& serializer);
@@ -105,43 +137,61 @@ public:
 private:
     Bus* m_bus;
     PPU* m_ppu;
-    A12Mapper* m_mapper;
+    A12Mapper* m_mapper = nullptr;
     SharedContext& context;
     // Overflow can only be set once per frame
     bool hasOverflowBeenSet = false;
     bool hasSprite0HitBeenSet = false;
     bool m_frameComplete = false;
     uint64_t _frameCount = 0;
+    bool m_skipOutputRequest = false;
+    bool m_skipOutput = false;
+    uint16_t* m_indexBuffer = nullptr;
 
     struct SpriteRenderData {
-        uint8_t x;           // X position on screen
-        uint8_t colorIndex;  // 03 (0 = transparent)
+        uint8_t colorIndex;  // 1-3, only pixels in m_spriteCoverage are filled in
         uint8_t palette;     // Lower 2 bits of attributes
         bool    behindBg;    // Priority bit
         bool    isZero;      // Is this sprite 0?
-		bool	valid;       // Is this a valid sprite pixel (used for sprite 0 hit detection)
     };
 
-	std::array<SpriteRenderData, 256> spriteLineBuffer;  // Places all sprites for current scanline so we only calculate it once
+	std::array<SpriteRenderData, 256> spriteLineBuffer{};  // Places all sprites for current scanline so we only calculate it once
+    // Bit x is set when spriteLineBuffer[x] holds an opaque sprite pixel. Clearing the line is 4 stores,
+    // and a sprite only writes the pixels no earlier sprite has already taken.
+    std::array<uint64_t, 4> m_spriteCoverage{};
+    inline bool hasSpritePixel(int x) const { return (m_spriteCoverage[x >> 6] >> (x & 63)) & 1; }
+    inline uint32_t spriteCoverage8(int x) const;
+    inline void setSpriteCoverage8(int x, uint32_t bits);
     void prepareSpriteLine(int y);
+
+    // Which OAM entries are in range of each scanline, bit n = sprite n. Only rebuilt when OAM or
+    // the sprite height changes, so evaluation doesn't have to look at all 64 sprites every line.
+    std::array<uint64_t, 256> m_spriteRows{};
+    bool m_spriteRowsDirty = true;
+    int m_spriteRowsHeight = 0;
+    void buildSpriteRows(int spriteHeight);
     
     uint8_t ppumask = 0;
     std::array<Sprite, 8> secondaryOAM{};
 
     // Tile info
-    TileFetch tile;
+    TileFetch tile{};
 
     // Fetchers / Shift Registers for the NEXT line
-    uint8_t spritePatternTableLow[8];
-    uint8_t spritePatternTableHigh[8];
-    uint16_t spritePatternAddrLow[8];
-    uint16_t spritePatternAddrHigh[8];
+    uint8_t spritePatternTableLow[8]{};
+    uint8_t spritePatternTableHigh[8]{};
+    uint16_t spritePatternAddrLow[8]{};
+    uint16_t spritePatternAddrHigh[8]{};
 
     void evaluateSprites(int screenY, std::array<Sprite, 8>& newOam);
     uint8_t get_pixel();
-    inline void ApplyColorEmphasis(uint32_t& finalColor);
     void renderPixel(uint32_t* buffer);
+    uint16_t composePixel(int x, uint8_t bgPixel, bool bgShown);
+    void writePixel(uint32_t* buffer, int offset, uint16_t index);
+    uint64_t tilePixels() const;
+    void advanceTile();
     void renderPixelBackground(uint32_t* buffer);
+    void checkSprite0Hit();
 
     // Internal helpers
     inline bool renderingEnabled() const { return (ppumask & 0x18) != 0; } // bg or sprites
@@ -151,5 +201,17 @@ private:
     void load_shift_registers();
     void shift_registers();
     uint8_t get_attribute_byte();
+
+    // Rendering fetches go straight to the mapper's page table
+    inline uint8_t readNametable(uint16_t addr);
+    inline uint8_t readPattern(uint16_t addr);
+    // A12 as the mapper last saw it from us (-1 = unknown). A run of fetches on the same side only
+    // matters to the mapper at its ends: the first can be an edge, the last high one starts the low time.
+    // So repeats are held back and only the latest high one is passed on, with the cycle it happened on.
+    int8_t m_a12Level = -1;
+    bool m_a12Pending = false;
+    uint16_t m_a12PendingAddr = 0;
+    uint64_t m_a12PendingClock = 0;
+    inline void notifyA12(uint16_t addr);
     uint8_t get_palette_from_attribute(uint8_t attr, uint8_t coarse_x, uint8_t coarse_y);
 };
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "RendererScanline.h"
+#include "RendererLoopy.h"
+#include "PPU.h"
+#include <algorithm>
+
+RendererScanline::RendererScanline(RendererLoopy& loopy, PPU& ppu) : loopy(loopy), ppu(ppu) {
+}
+
+bool RendererScanline::canRenderLine() const {
+    return loopy.m_scanline < 240 && (loopy.dot & 7) == 1 && loopy.dot <= 249 && loopy.renderingEnabled() && !loopy.m_skipOutput;
+}
+
+int RendererScanline::dotsToLineEnd() const {
+    return 257 - loopy.dot;
+}
+
+/// <summary>
+/// Same as calling RendererLoopy::clock() from the current dot up to the end of dot 256.
+/// </summary>
+void RendererScanline::renderLine(uint32_t* buffer) {
+    m_linesRendered++;
+    Line& line = m_line;
+    line.buffer = buffer;
+    line.indexBuffer = loopy.m_indexBuffer;
+    line.y = loopy.m_scanline;
+    line.xStart = loopy.dot - 1;
+    line.mask = loopy.ppumask;
+    for (int tile = line.xStart / 8; tile < 32; tile++) {
+        uint64_t pixels = loopy.tilePixels();
+        for (int i = 0; i < 8; i++) {
+            line.bg[tile * 8 + i] = (uint8_t)(pixels >> (i * 8));
+        }
+        // The fetch is on the last of the 8 dots, the clock has to be there already
+        ppu.m_clock += 8;
+        loopy.advanceTile();
+    }
+
+    if (loopy.spriteEnabled()) {
+        line.coverage = loopy.m_spriteCoverage;
+        for (int block = 0; block < 4; block++) {
+            uint64_t bits = line.coverage[block];
+            for (int x = block * 64; bits != 0; ++x, bits >>= 1) {
+                if (bits & 1) {
+                    const auto& spr = loopy.spriteLineBuffer[x];
+                    line.sprites[x] = (uint8_t)(spr.colorIndex | (spr.palette << 2) | (spr.behindBg ? 0x10 : 0));
+                }
+            }
+        }
+        checkSprite0Hit(line);
+    }
+    else {
+        line.coverage.fill(0);
+    }
+    std::copy(ppu.paletteTable.begin(), ppu.paletteTable.end(), line.palette.begin());
+
+    compose(line, ppu.colorTable.data());
+}
+
+/// <summary>
+/// Sprite 0 hit for the line, as composePixel() would have raised it. Only sprite 0's own 8 pixels can hit,
+/// and it is always in the first slot when it's on the line.
+/// </summary>
+void RendererScanline::checkSprite0Hit(const Line& line) {
+    const auto& sprite0 = loopy.secondaryOAM[0];
+    if (!sprite0.isSprite0 || loopy.hasSprite0HitBeenSet || !loopy.bgEnabled()) {
+        return;
+    }
+    // Left 8 pixels need both the background and sprites shown there
+    bool leftShown = (line.mask & (PPUMASK_BACKGRONDLEFT | PPUMASK_SPRITELEFT)) == (PPUMASK_BACKGRONDLEFT | PPUMASK_SPRITELEFT);
+    int last = (std::min)(sprite0.x + 8, 255);
+    for (int x = (std::max)((int)sprite0.x, line.xStart); x < last; x++) {
+        if (!loopy.hasSpritePixel(x) || !loopy.spriteLineBuffer[x].isZero || (x < 8 && !leftShown)) {
+            continue;
+        }
+        if (line.bg[x] != 0) {
+            loopy.hasSprite0HitBeenSet = true;
+            ppu.SetPPUStatus(0x40);
+            return;
+        }
+    }
+}
+
+void RendererScanline::compose(const Line& line, const uint32_t* colorTable) {
+    for (int x0 = line.xStart; x0 < 256; x0 = (x0 + 64) & ~63) {
+        int count = ((x0 + 64) & ~63) - x0;
+        if (line.coverage[x0 >> 6] != 0) {
+            composeSprites(line, x0, count, colorTable);
+        }
+        else {
+            composeBackground(line, x0, count, colorTable);
+        }
+    }
+}
+
+/// <summary>
+/// For pixels no sprite covers: just the background color, looked up per palette entry once.
+/// </summary>
+void RendererScanline::composeBackground(const Line& line, int x0, int count, const uint32_t* colorTable) {
+    uint8_t mask = line.mask;
+    uint8_t grayMask = (mask & PPUMASK_GRAYSCALE) ? 0x30 : 0x3F;
+    uint16_t emphasis = (uint16_t)((mask & 0xE0) << 1);
+    bool bgShown = (mask & PPUMASK_BACKGROUNDENABLED) != 0;
+    bool bgShownLeft = bgShown && (mask & PPUMASK_BACKGRONDLEFT) != 0;
+
+    uint16_t indices[16];
+    for (int i = 0; i < 16; i++) {
+        indices[i] = emphasis | (line.palette[i] & grayMask);
+    }
+    // Hidden background shows the backdrop color without grayscale
+    uint16_t hidden = emphasis | line.palette[0];
+
+    int offset = line.y * 256 + x0;
+    if (line.indexBuffer) {
+        uint16_t* out = line.indexBuffer + offset;
+        for (int i = 0, x = x0; i < count; i++, x++) {
+            bool shown = x >= 8 ? bgShown : bgShownLeft;
+            out[i] = shown ? indices[line.bg[x]] : hidden;
+        }
+        return;
+    }
+    uint32_t colors[16];
+    for (int i = 0; i < 16; i++) {
+        colors[i] = colorTable[indices[i]];
+    }
+    uint32_t hiddenColor = colorTable[hidden];
+    uint32_t* out = line.buffer + offset;
+    for (int i = 0, x = x0; i < count; i++, x++) {
+        bool shown = x >= 8 ? bgShown : bgShownLeft;
+        out[i] = shown ? colors[line.bg[x]] : hiddenColor;
+    }
+}
+
+/// <summary>
+/// RendererLoopy::composePixel() for blocks that have sprites in them, without the sprite 0 hit.
+/// </summary>
+void RendererScanline::composeSprites(const Line& line, int x0, int count, const uint32_t* colorTable) {
+    uint8_t mask = line.mask;
+    uint8_t grayMask = (mask & PPUMASK_GRAYSCALE) ? 0x30 : 0x3F;
+    uint16_t emphasis = (uint16_t)((mask & 0xE0) << 1);
+    bool bgShown = (mask & PPUMASK_BACKGROUNDENABLED) != 0;
+    bool bgShownLeft = bgShown && (mask & PPUMASK_BACKGRONDLEFT) != 0;
+    bool spritesShown = (mask & PPUMASK_SPRITEENABLED) != 0;
+    bool spritesShownLeft = spritesShown && (mask & PPUMASK_SPRITELEFT) != 0;
+
+    int offset = line.y * 256 + x0;
+    for (int i = 0, x = x0; i < count; i++, x++) {
+        bool shown = x >= 8 ? bgShown : bgShownLeft;
+        uint8_t bgPixel = shown ? line.bg[x] : 0;
+        uint8_t index = shown ? (line.palette[bgPixel] & grayMask) : line.palette[0];
+        bool covered = (line.coverage[x >> 6] >> (x & 63)) & 1;
+        if (covered && (x >= 8 ? spritesShown : spritesShownLeft)) {
+            uint8_t sprite = line.sprites[x];
+            if (!(sprite & 0x10) || bgPixel == 0) {
+                index = line.palette[0x10 + (sprite & 0x0F)] & grayMask;
+            }
+        }
+        if (line.indexBuffer) {
+            line.indexBuffer[offset + i] = emphasis | index;
+        }
+        else {
+            line.buffer[offset + i] = colorTable[emphasis | index];
+        }
+    }
+}
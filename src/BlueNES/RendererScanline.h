@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+#include <array>
+
+class RendererLoopy;
+class PPU;
+
+// Whole-line renderer for when the PPU is catching up over the rest of the visible dots of a line.
+// Mappers that watch A12 stop catch-up at the first background fetch, so the line can start at any tile.
+// Works from the same state as RendererLoopy: the background fetches are done tile by tile in the
+// same order and on the same cycles (so mappers see nothing different), the background goes into
+// a line buffer, and the line is composed with the sprites afterwards, 64 pixels at a time where
+// no sprite is.
+// Mid-line $2000/$2001/$2005/$2006 writes need no special handling. Catch-up runs the PPU up to
+// every register access, so a line with one in the middle is never handed to us in one piece and
+// RendererLoopy, which stays the dot-accurate reference, does it instead.
+class RendererScanline
+{
+public:
+    // Everything composing a line needs, gathered while its tiles are fetched
+    struct Line {
+        uint32_t* buffer;
+        uint16_t* indexBuffer;
+        int y;
+        int xStart;
+        uint8_t mask;
+        std::array<uint8_t, 32> palette;
+        std::array<uint8_t, 256> bg;       // palette << 2 | color, 0 = transparent
+        std::array<uint8_t, 256> sprites;  // color | palette << 2 | behind << 4, only where coverage is set
+        std::array<uint64_t, 4> coverage;
+    };
+
+    RendererScanline(RendererLoopy& loopy, PPU& ppu);
+
+    // At the start of a tile on a visible line with rendering on
+    bool canRenderLine() const;
+    // How many dots renderLine() is going to run
+    int dotsToLineEnd() const;
+    // Runs the rest of dots 1-256 and moves the PPU clock along with them, a tile at a time
+    void renderLine(uint32_t* buffer);
+    // How many times renderLine() has run, whole lines or the rest of one
+    uint64_t linesRendered() const { return m_linesRendered; }
+
+    // The pixels of a line. Nothing the CPU can see happens here, sprite 0 hit is done while rendering.
+    static void compose(const Line& line, const uint32_t* colorTable);
+
+private:
+    RendererLoopy& loopy;
+    PPU& ppu;
+    Line m_line{};
+    uint64_t m_linesRendered = 0;
+
+    void checkSprite0Hit(const Line& line);
+    static void composeBackground(const Line& line, int x0, int count, const uint32_t* colorTable);
+    static void composeSprites(const Line& line, int x0, int count, const uint32_t* colorTable);
+};
@@ -0,0 +1,227 @@
+#include "RewindBuffer.h"
+#include "Nes.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+RewindBuffer::RewindBuffer(size_t budgetBytes, int interval) : budget(budgetBytes), interval((std::max)(interval, 1)) {
+}
+
+void RewindBuffer::SetInterval(int frames) {
+    interval = (std::max)(frames, 1);
+}
+
+void RewindBuffer::OnFrame(Nes& nes) {
+    // Moved on from what was rewound to, rewinding again goes back to it first
+    rewound = false;
+    if (++framesSinceCapture < interval) {
+        return;
+    }
+    framesSinceCapture = 0;
+    Capture(nes);
+}
+
+void RewindBuffer::Capture(Nes& nes) {
+    auto start = std::chrono::steady_clock::now();
+    nes.SaveToBuffer(next);
+    if (hasCurrent) {
+        // The delta takes the new state back to the current one. They're the same size unless
+        // something like PRG-RAM changed size, then the shorter one counts as zeros past its end.
+        size_t span = (std::max)(current.size, next.size);
+        PadTo(current, span);
+        PadTo(next, span);
+        if (delta.size() < span * 2 + 16) {
+            delta.resize(span * 2 + 16);
+        }
+        size_t bytes = Encode(current.data(), next.data(), span, delta.data());
+        uint8_t* out = Allocate(bytes);
+        if (out) {
+            std::memcpy(out, delta.data(), bytes);
+            entries.push_back({ (size_t)(out - ring.data()), bytes, span, current.size });
+        }
+        lastDeltaBytes = bytes;
+    }
+    else {
+        lastDeltaBytes = next.size;
+    }
+    std::swap(current, next);
+    hasCurrent = true;
+
+    lastCaptureNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    captures++;
+    totalDeltaBytes += lastDeltaBytes;
+    totalCaptureNs += lastCaptureNs;
+}
+
+bool RewindBuffer::StepBack(Nes& nes) {
+    if (!hasCurrent) {
+        return false;
+    }
+    if (rewound && !entries.empty()) {
+        // XOR is its own inverse, the newest delta turns current into the capture before it
+        const Entry& entry = entries.back();
+        PadTo(current, entry.span);
+        Apply(ring.data() + entry.offset, entry.bytes, current.bytes.data());
+        current.size = entry.prevSize;
+        head = entry.offset;
+        entries.pop_back();
+    }
+    // Left as the newest capture, the next one is a delta against the state we really went back to
+    nes.LoadFromBuffer(current);
+    rewound = true;
+    framesSinceCapture = 0;
+    return true;
+}
+
+void RewindBuffer::Clear() {
+    entries.clear();
+    head = 0;
+    hasCurrent = false;
+    rewound = false;
+    framesSinceCapture = 0;
+    if (ring.size() != budget) {
+        std::vector<uint8_t>().swap(ring);
+    }
+}
+
+size_t RewindBuffer::GetBytesUsed() const {
+    size_t used = hasCurrent ? current.size : 0;
+    for (const Entry& entry : entries) {
+        used += entry.bytes;
+    }
+    return used;
+}
+
+double RewindBuffer::GetAverageDeltaBytes() const {
+    return captures == 0 ? 0.0 : (double)totalDeltaBytes / captures;
+}
+
+double RewindBuffer::GetAverageCaptureNs() const {
+    return captures == 0 ? 0.0 : (double)totalCaptureNs / captures;
+}
+
+void RewindBuffer::ResetStats() {
+    captures = 0;
+    totalDeltaBytes = 0;
+    totalCaptureNs = 0;
+}
+
+/// <summary>
+/// Room in the ring for a delta, pushing out the oldest ones in the way. Deltas are never split,
+/// if there isn't room before the end of the ring the delta goes at the start.
+/// </summary>
+uint8_t* RewindBuffer::Allocate(size_t bytes) {
+    if (ring.empty()) {
+        ring.resize(budget);
+    }
+    if (bytes > ring.size()) {
+        // Bigger than the whole budget, there's no history to keep
+        entries.clear();
+        head = 0;
+        return nullptr;
+    }
+    if (head + bytes > ring.size()) {
+        // Whatever is past head is from the last lap around, the oldest
+        while (!entries.empty() && entries.front().offset >= head) {
+            entries.pop_front();
+        }
+        head = 0;
+    }
+    while (!entries.empty() && entries.front().offset >= head && entries.front().offset < head + bytes) {
+        entries.pop_front();
+    }
+    uint8_t* out = ring.data() + head;
+    head += bytes;
+    return out;
+}
+
+// Zeros from the end of the state up to size, so two states of different sizes can be XORed
+void RewindBuffer::PadTo(StateBuffer& state, size_t size) {
+    if (state.bytes.size() < size) {
+        state.bytes.resize(size);
+    }
+    if (state.size < size) {
+        std::memset(state.bytes.data() + state.size, 0, size - state.size);
+    }
+}
+
+static uint8_t* writeVarint(uint8_t* out, size_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+static const uint8_t* readVarint(const uint8_t* in, size_t& value) {
+    value = 0;
+    for (int shift = 0; ; shift += 7) {
+        uint8_t b = *in++;
+        value |= (size_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return in;
+        }
+    }
+}
+
+/// <summary>
+/// a XOR b as runs: [zero count][literal count][literal bytes], repeated. A literal run only ends
+/// at 4 zeros in a row, shorter gaps are cheaper to keep in it. Needs up to size * 2 + 16 bytes of out.
+/// </summary>
+size_t RewindBuffer::Encode(const uint8_t* a, const uint8_t* b, size_t size, uint8_t* out) {
+    uint8_t* o = out;
+    size_t i = 0;
+    while (i < size) {
+        size_t zeroStart = i;
+        // Most of it is unchanged, skip that 8 bytes at a time
+        while (i + 8 <= size) {
+            uint64_t wa, wb;
+            std::memcpy(&wa, a + i, 8);
+            std::memcpy(&wb, b + i, 8);
+            if (wa != wb) {
+                break;
+            }
+            i += 8;
+        }
+        while (i < size && a[i] == b[i]) {
+            i++;
+        }
+        size_t literalStart = i;
+        size_t literalEnd = i;
+        while (i < size) {
+            if (a[i] != b[i]) {
+                literalEnd = ++i;
+            }
+            else if (i - literalEnd >= 3) {
+                break;
+            }
+            else {
+                i++;
+            }
+        }
+        i = literalEnd;
+        o = writeVarint(o, literalStart - zeroStart);
+        o = writeVarint(o, literalEnd - literalStart);
+        for (size_t k = literalStart; k < literalEnd; k++) {
+            *o++ = a[k] ^ b[k];
+        }
+    }
+    return o - out;
+}
+
+void RewindBuffer::Apply(const uint8_t* delta, size_t bytes, uint8_t* target) {
+    const uint8_t* end = delta + bytes;
+    size_t pos = 0;
+    while (delta < end) {
+        size_t zeros, literals;
+        delta = readVarint(delta, zeros);
+        delta = readVarint(delta, literals);
+        pos += zeros;
+        for (size_t k = 0; k < literals; k++) {
+            target[pos + k] ^= delta[k];
+        }
+        delta += literals;
+        pos += literals;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include "Serializer.h"
+
+class Nes;
+
+// Rewind history. Every interval frames the whole machine is captured with Nes::SaveToBuffer,
+// and only what changed since the capture before is kept: the two states XORed together, zero
+// nearly everywhere, with the zero runs squeezed out. The newest capture is kept whole, so going
+// back one step is XORing the newest delta into it. There are no keyframes to replay forward from,
+// and dropping the oldest deltas when the budget runs out doesn't break the ones after them.
+// Deltas go into one block of memory used as a ring, allocated on the first capture.
+class RewindBuffer
+{
+public:
+    explicit RewindBuffer(size_t budgetBytes = 64 * 1024 * 1024, int interval = 2);
+
+    // Call once a frame the game runs forward, every interval-th call captures
+    void OnFrame(Nes& nes);
+    // Loads the newest capture, then the one before it on each call after that. The oldest
+    // one stays once it's reached. False if nothing has been captured.
+    // Whatever it loaded last stays the newest capture, so playing on from there loses nothing.
+    bool StepBack(Nes& nes);
+    // Forgets everything, for when another game is loaded
+    void Clear();
+
+    void SetInterval(int frames);
+    int GetInterval() const { return interval; }
+    // Takes effect on the next capture after a Clear()
+    void SetBudget(size_t bytes) { budget = bytes; }
+    size_t GetBudget() const { return budget; }
+
+    // Captures StepBack() can go through
+    size_t GetCount() const { return hasCurrent ? entries.size() + 1 : 0; }
+    size_t GetBytesUsed() const;
+
+    // Compressed size of the newest delta and the average, divide by the interval for bytes per frame
+    size_t GetLastDeltaBytes() const { return lastDeltaBytes; }
+    double GetAverageDeltaBytes() const;
+    // Time a capture takes: saving, the delta and compressing it
+    int64_t GetLastCaptureNs() const { return lastCaptureNs; }
+    double GetAverageCaptureNs() const;
+    void ResetStats();
+
+private:
+    struct Entry {
+        size_t offset;   // In ring
+        size_t bytes;
+        size_t span;     // Bytes the delta covers, the bigger of the two states
+        size_t prevSize; // Size of the state it takes us back to
+    };
+
+    size_t budget;
+    int interval;
+    int framesSinceCapture = 0;
+
+    StateBuffer current; // Newest capture, whole
+    StateBuffer next;    // Captured into, then swapped with current
+    bool hasCurrent = false;
+    bool rewound = false; // current is what StepBack() loaded last, the next step goes past it
+    std::vector<uint8_t> delta; // Encoded here before going into the ring
+
+    std::vector<uint8_t> ring;
+    size_t head = 0; // Where the next delta goes
+    std::deque<Entry> entries;
+
+    size_t lastDeltaBytes = 0;
+    int64_t lastCaptureNs = 0;
+    uint64_t captures = 0;
+    uint64_t totalDeltaBytes = 0;
+    int64_t totalCaptureNs = 0;
+
+    void Capture(Nes& nes);
+    uint8_t* Allocate(size_t bytes);
+    static void PadTo(StateBuffer& state, size_t size);
+    static size_t Encode(const uint8_t* a, const uint8_t* b, size_t size, uint8_t* out);
+    static void Apply(const uint8_t* delta, size_t bytes, uint8_t* target);
+};
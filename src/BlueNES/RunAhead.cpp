@@ -0,0 +1,182 @@
+#include "RunAhead.h"
+#include "Nes.h"
+#include "PPU.h"
+#include "APU.h"
+#include "Bus.h"
+#include "Input.h"
+#include "Cartridge.h"
+#include "SharedContext.h"
+#include "RendererLoopy.h"
+#include <algorithm>
+#include <chrono>
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+RunAhead::RunAhead(Nes& nes) : nes(nes), blip(*nes.blip_) {
+}
+
+RunAhead::~RunAhead() {
+    stopSecondInstance();
+}
+
+void RunAhead::SetFrames(int count) {
+    Finish();
+    frames = (std::max)(0, (std::min)(count, MAX_FRAMES));
+}
+
+void RunAhead::SetSecondInstance(bool enabled, const std::string& romPath) {
+    stopSecondInstance();
+    if (!enabled || romPath.empty()) {
+        return;
+    }
+    aheadContext = std::make_unique<SharedContext>();
+    ahead = std::make_unique<Nes>(*aheadContext);
+    // Powered up the way EmulatorCore loads a game, the states loaded into it only cover what a game can change
+    ahead->ppu_->reset();
+    ahead->apu_->reset();
+    ahead->bus_->PowerCycle();
+    ahead->cart_->LoadROM(romPath);
+    ahead->cpu_->PowerCycle();
+    if (!ahead->cart_->isLoaded()) {
+        ahead.reset();
+        aheadContext.reset();
+        return;
+    }
+    Nes* second = ahead.get();
+    second->apu_->set_dmc_read_callback([second](uint16_t address) -> uint8_t {
+        return second->bus_->read(address);
+    });
+    CopyVideoSettings();
+    stopping = false;
+    worker = std::thread(&RunAhead::workerLoop, this);
+}
+
+void RunAhead::CopyVideoSettings() {
+    if (!ahead) {
+        return;
+    }
+    // Not while it's drawing a frame with them
+    Finish();
+    ahead->ppu_->colorTable = nes.ppu_->colorTable;
+    ahead->ppu_->SetScanlineRenderer(nes.ppu_->IsScanlineRenderer());
+    ahead->ppu_->SetIndexBuffer(nes.ppu_->GetIndexBuffer());
+}
+
+void RunAhead::stopSecondInstance() {
+    if (!ahead) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+    jobPending = false;
+    // It only ever ran ahead, its battery RAM isn't the one to keep
+    ahead->cart_->unload(false);
+    ahead.reset();
+    aheadContext.reset();
+}
+
+void RunAhead::Start(uint32_t* buffer) {
+    if (frames == 0) {
+        return;
+    }
+    int64_t start = nowNs();
+    if (ahead) {
+        Finish();
+        nes.SaveToBuffer(state);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobBuffer = buffer;
+            jobInput = nes.input_->GetState();
+            jobPending = true;
+        }
+        cv.notify_all();
+    }
+    else {
+        nes.SaveToBuffer(state);
+        // The band-limited buffer isn't part of the state, the frames ahead would leave their audio in it
+        blip = *nes.blip_;
+        blipLevel = nes.apu_->blip_level;
+        input = nes.input_->GetState();
+        // Breakpoints are for the real frames, the debugger must not stop in one that gets thrown away
+        bool attached = nes.cpu_->IsDebuggerAttached();
+        nes.cpu_->SetDebuggerAttached(false);
+        runFrames(nes, buffer);
+        nes.cpu_->SetDebuggerAttached(attached);
+        nes.LoadFromBuffer(state);
+        nes.input_->SetState(input);
+        *nes.blip_ = blip;
+        nes.apu_->blip_level = blipLevel;
+        nes.apu_->blip_time = 0;
+    }
+    frameOverheadNs = nowNs() - start;
+}
+
+void RunAhead::Finish() {
+    if (ahead) {
+        int64_t start = nowNs();
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return !jobPending; });
+        frameOverheadNs += nowNs() - start;
+    }
+    if (frameOverheadNs == 0) {
+        return;
+    }
+    lastOverheadNs = frameOverheadNs;
+    totalOverheadNs += frameOverheadNs;
+    samples++;
+    frameOverheadNs = 0;
+}
+
+double RunAhead::GetAverageOverheadNs() const {
+    return samples == 0 ? 0.0 : (double)totalOverheadNs / samples;
+}
+
+void RunAhead::ResetStats() {
+    totalOverheadNs = 0;
+    samples = 0;
+}
+
+/// <summary>
+/// The frames ahead, from the end of one VBlank to the next like EmulatorCore::runFrame().
+/// Only the last is drawn, none of their audio is kept.
+/// </summary>
+void RunAhead::runFrames(Nes& target, uint32_t* buffer) {
+    for (int i = 0; i < frames; i++) {
+        target.ppu_->SetSkipOutput(i < frames - 1);
+        target.ppu_->setBuffer(buffer);
+        target.ppu_->renderer->m_frameTick = false;
+        while (!target.frameReady()) {
+            if (target.instructionStepped) {
+                target.stepInstruction();
+            }
+            else {
+                target.clock();
+            }
+        }
+        target.endAudioFrame();
+        target.audioBuffer.clear();
+    }
+}
+
+void RunAhead::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this] { return jobPending || stopping; });
+        if (stopping) {
+            return;
+        }
+        lock.unlock();
+        ahead->LoadFromBuffer(state);
+        ahead->input_->SetState(jobInput);
+        runFrames(*ahead, jobBuffer);
+        lock.lock();
+        jobPending = false;
+        cv.notify_all();
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include "Serializer.h"
+#include "BlipBuffer.h"
+#include "Input.h"
+
+class Nes;
+class SharedContext;
+
+// Run-ahead takes out the frames of lag a game has between reading the controller and showing
+// what it did with it. After each real frame the emulation keeps going for a few more frames with
+// the input just read, the last of them is what gets shown, and then it goes back to the end of
+// the real frame. The real frame isn't drawn, the ones ahead aren't heard.
+// The frames ahead can also run on a second Nes on a thread of its own. Ours then only ever saves
+// its state, so its audio, rewind and the debugger never see a state being loaded, and the core
+// thread does its end of frame work while the other one runs ahead.
+class RunAhead
+{
+public:
+    static constexpr int MAX_FRAMES = 3;
+
+    RunAhead(Nes& nes);
+    ~RunAhead();
+
+    // 0 turns it off
+    void SetFrames(int frames);
+    int GetFrames() const { return frames; }
+    bool IsEnabled() const { return frames > 0; }
+    // The second Nes loads romPath. Disabling it, or an empty path, runs ahead on ours again.
+    void SetSecondInstance(bool enabled, const std::string& romPath);
+    bool IsSecondInstance() const { return ahead != nullptr; }
+    // The second Nes draws the frames that are shown, so it takes our palette, renderer and index
+    // output when it's made. Call again after changing any of them.
+    void CopyVideoSettings();
+
+    // Call after the real frame, run with PPU::SetSkipOutput(true). Runs the frames ahead, the
+    // last one drawn into buffer. With a second instance this only starts them.
+    void Start(uint32_t* buffer);
+    // Returns once buffer has the frame in it
+    void Finish();
+
+    // Core thread time Start() and Finish() took, the last frame's and the average
+    int64_t GetLastOverheadNs() const { return lastOverheadNs; }
+    double GetAverageOverheadNs() const;
+    void ResetStats();
+
+private:
+    Nes& nes;
+    int frames = 0;
+
+    // Single instance: where the real frame ended, the audio that was pending then and the controllers
+    StateBuffer state;
+    Input::State input{};
+    BlipBuffer blip;
+    float blipLevel = 0.0f;
+
+    // Second instance
+    std::unique_ptr<SharedContext> aheadContext;
+    std::unique_ptr<Nes> ahead;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool jobPending = false;
+    bool stopping = false;
+    uint32_t* jobBuffer = nullptr;
+    Input::State jobInput{};
+
+    int64_t frameOverheadNs = 0; // So far this frame
+    int64_t lastOverheadNs = 0;
+    int64_t totalOverheadNs = 0;
+    uint64_t samples = 0;
+
+    void runFrames(Nes& target, uint32_t* buffer);
+    void workerLoop();
+    void stopSecondInstance();
+};
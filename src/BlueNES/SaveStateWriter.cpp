@@ -0,0 +1,139 @@
+#include "SaveStateWriter.h"
+#include "SharedContext.h"
+#include <zlib.h>
+#include <Windows.h>
+#include <stdexcept>
+#include <cstring>
+
+SaveStateWriter::SaveStateWriter(SharedContext& ctx) : context(ctx) {
+    worker = std::thread(&SaveStateWriter::workerLoop, this);
+}
+
+SaveStateWriter::~SaveStateWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+StateBuffer SaveStateWriter::TakeBuffer() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (spare.empty()) {
+        return StateBuffer();
+    }
+    StateBuffer buffer = std::move(spare.back());
+    spare.pop_back();
+    return buffer;
+}
+
+void SaveStateWriter::Write(StateBuffer&& state, const std::filesystem::path& path, std::chrono::steady_clock::time_point requested) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back({ std::move(state), path, requested });
+    }
+    cv.notify_all();
+}
+
+void SaveStateWriter::Flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return jobs.empty() && !busy; });
+}
+
+void SaveStateWriter::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cv.wait(lock, [this] { return !jobs.empty() || stopping; });
+        if (jobs.empty()) {
+            return;
+        }
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        busy = true;
+        lock.unlock();
+
+        bool written = writeFile(job);
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - job.requested);
+        context.saveStateLatencyUs.store((uint32_t)latency.count(), std::memory_order_relaxed);
+        context.saveStateFailed.store(!written, std::memory_order_relaxed);
+
+        lock.lock();
+        // One to save into next time and one for a save made while this one was being written
+        if (spare.size() < 2) {
+            spare.push_back(std::move(job.state));
+        }
+        busy = false;
+        cv.notify_all();
+    }
+}
+
+bool SaveStateWriter::writeFile(const Job& job) {
+    if (!Compress(job.state, compressed)) {
+        return false;
+    }
+    std::filesystem::path temp = job.path;
+    temp += L".tmp";
+    {
+        HANDLE file = CreateFileW(temp.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        DWORD written = 0;
+        bool ok = WriteFile(file, compressed.data(), (DWORD)compressed.size(), &written, nullptr) && written == compressed.size();
+        // On disk before the rename, or a crash can leave the new name pointing at data that never got there
+        ok = ok && FlushFileBuffers(file);
+        CloseHandle(file);
+        if (!ok) {
+            std::error_code ec;
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+    // Replaces the old file in one step, it's never half written
+    std::error_code ec;
+    std::filesystem::rename(temp, job.path, ec);
+    if (ec) {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    context.saveStateBytes.store((uint32_t)compressed.size(), std::memory_order_relaxed);
+    return true;
+}
+
+bool SaveStateWriter::IsCompressed(const uint8_t* data, size_t size) {
+    uint32_t magic;
+    if (size < sizeof(CompressedStateHeader)) {
+        return false;
+    }
+    memcpy(&magic, data, sizeof(magic));
+    return magic == COMPRESSED_STATE_MAGIC;
+}
+
+bool SaveStateWriter::Compress(const StateBuffer& state, std::vector<uint8_t>& out) {
+    CompressedStateHeader header = {};
+    header.magic = COMPRESSED_STATE_MAGIC;
+    header.size = state.size;
+    uLongf bound = compressBound((uLong)state.size);
+    out.resize(sizeof(header) + bound);
+    memcpy(out.data(), &header, sizeof(header));
+    // Off the core thread, so it can afford more than the fastest level
+    if (compress2(out.data() + sizeof(header), &bound, state.data(), (uLong)state.size, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        return false;
+    }
+    out.resize(sizeof(header) + bound);
+    return true;
+}
+
+void SaveStateWriter::Decompress(const uint8_t* data, size_t size, StateBuffer& out) {
+    CompressedStateHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (out.bytes.size() < header.size) {
+        out.bytes.resize((size_t)header.size);
+    }
+    uLongf inflated = (uLongf)header.size;
+    if (uncompress(out.bytes.data(), &inflated, data + sizeof(header), (uLong)(size - sizeof(header))) != Z_OK || inflated != header.size) {
+        throw std::runtime_error("Save state is damaged");
+    }
+    out.size = inflated;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <filesystem>
+#include "Serializer.h"
+
+class SharedContext;
+
+// Compressed save state files start with this, then the state deflated with zlib
+#define COMPRESSED_STATE_MAGIC 0x5A534E42 // "BNSZ"
+
+struct CompressedStateHeader {
+	uint32_t magic;
+	uint32_t reserved;
+	uint64_t size; // Of the state once it's inflated
+};
+
+// Writes save states to disk on a thread of its own. The core thread only takes the snapshot,
+// compressing it and waiting on the disk happen here. Each file is written next to the one it
+// replaces and renamed over it, a crash or a full disk mid-write leaves the old state as it was.
+// How long it took and how big it came out go to SharedContext.
+class SaveStateWriter
+{
+public:
+    static constexpr int SLOTS = 10;
+
+    SaveStateWriter(SharedContext& ctx);
+    // Whatever is queued is written first
+    ~SaveStateWriter();
+
+    // A buffer to take the snapshot in, one a finished write gave back if there is one
+    StateBuffer TakeBuffer();
+    // Queues state to be written to path. requested is when the save was asked for.
+    void Write(StateBuffer&& state, const std::filesystem::path& path, std::chrono::steady_clock::time_point requested);
+    // Returns once everything queued is on disk
+    void Flush();
+
+    // Save states written before compression aren't, they still load
+    static bool IsCompressed(const uint8_t* data, size_t size);
+    // Throws if it's damaged
+    static void Decompress(const uint8_t* data, size_t size, StateBuffer& out);
+    // Header and all, ready to write. False if zlib fails.
+    static bool Compress(const StateBuffer& state, std::vector<uint8_t>& out);
+
+private:
+    struct Job {
+        StateBuffer state;
+        std::filesystem::path path;
+        std::chrono::steady_clock::time_point requested;
+    };
+
+    SharedContext& context;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Job> jobs;
+    bool busy = false;
+    bool stopping = false;
+    std::vector<StateBuffer> spare; // Given back by finished writes, so snapshots don't allocate
+    std::vector<uint8_t> compressed;
+
+    void workerLoop();
+    bool writeFile(const Job& job);
+};
@@ -2,20 +2,160 @@
 #include <iostream>
 #include <cstdint>
 #include <vector>
-
-#define VERSION 1
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <string>
 
 void Serializer::StartSerialization(std::ostream& os) {
 	this->os = &os;
-    uint32_t version = VERSION;
-    Write(version);
+	osStart = os.tellp();
+}
+
+void Serializer::StartSerialization(StateBuffer& buffer) {
+	out = &buffer;
+	buffer.size = 0;
 }
 
 void Serializer::StartDeserialization(std::istream& is) {
-	this->is = &is;
-    uint32_t version;
-    Read(version);
-    if (version != VERSION) {
-        throw std::runtime_error("Unsupported serialization version");
-    }
-}
\ No newline at end of file
+	streamData.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+	StartDeserialization(streamData.data(), streamData.size());
+}
+
+void Serializer::StartDeserialization(const uint8_t* data, size_t size) {
+	inStart = in = data;
+	inEnd = data + size;
+}
+
+void Serializer::WriteHeader(uint64_t romHash, uint8_t region) {
+	HeaderState header = {};
+	header.magic = STATE_MAGIC;
+	header.version = STATE_VERSION;
+	header.romHash = romHash;
+	header.region = region;
+	Write(header);
+}
+
+HeaderState Serializer::ReadHeader() {
+	HeaderState header = {};
+	uint32_t first;
+	Read(first);
+	if (first == STATE_VERSION_UNCHUNKED) {
+		// Everything follows in the order it's asked for
+		unchunked = true;
+		header.version = STATE_VERSION_UNCHUNKED;
+		header.region = STATE_REGION_NTSC;
+		return header;
+	}
+	if (first != STATE_MAGIC) {
+		throw std::runtime_error("Not a save state");
+	}
+	in -= sizeof(first);
+	Read(header);
+	if (header.version != STATE_VERSION) {
+		throw std::runtime_error("Unsupported serialization version");
+	}
+	bodyStart = in;
+	bodyEnd = inEnd;
+	return header;
+}
+
+void Serializer::BeginChunk(uint32_t tag, uint16_t version) {
+	PadTo8();
+	writeChunks.push_back(WritePosition());
+	ChunkHeader header = {};
+	header.tag = tag;
+	header.version = version;
+	Write(header);
+}
+
+void Serializer::EndChunk() {
+	size_t headerAt = writeChunks.back();
+	writeChunks.pop_back();
+	size_t end = WritePosition();
+	uint32_t size = (uint32_t)(end - headerAt - sizeof(ChunkHeader));
+	size_t sizeAt = headerAt + offsetof(ChunkHeader, size);
+	if (out) {
+		memcpy(out->bytes.data() + sizeAt, &size, sizeof(size));
+	}
+	else {
+		os->seekp(osStart + (std::streamoff)sizeAt);
+		os->write(reinterpret_cast<const char*>(&size), sizeof(size));
+		os->seekp(osStart + (std::streamoff)end);
+	}
+}
+
+bool Serializer::OpenChunk(uint32_t tag) {
+	if (unchunked) {
+		return true;
+	}
+	const uint8_t* p = readChunks.empty() ? bodyStart : readChunks.back().data;
+	const uint8_t* end = readChunks.empty() ? bodyEnd : readChunks.back().end;
+	while (true) {
+		// Each header starts 8-byte aligned, the padding before it isn't counted in any size
+		p = inStart + ((p - inStart + 7) & ~(ptrdiff_t)7);
+		if (p >= end) {
+			return false;
+		}
+		ChunkHeader header;
+		if ((size_t)(end - p) < sizeof(header)) {
+			throw std::runtime_error("Save state is truncated");
+		}
+		memcpy(&header, p, sizeof(header));
+		const uint8_t* data = p + sizeof(header);
+		if (header.size > (size_t)(end - data)) {
+			throw std::runtime_error("Save state is truncated");
+		}
+		if (header.tag == tag) {
+			readChunks.push_back({ data, data + header.size, header.version });
+			in = data;
+			inEnd = data + header.size;
+			return true;
+		}
+		// Someone else's, or from a newer version
+		p = data + header.size;
+	}
+}
+
+void Serializer::RequireChunk(uint32_t tag) {
+	if (!OpenChunk(tag)) {
+		std::string name(reinterpret_cast<const char*>(&tag), 4);
+		throw std::runtime_error("Save state has no " + name + " chunk");
+	}
+}
+
+void Serializer::CloseChunk() {
+	if (unchunked) {
+		return;
+	}
+	readChunks.pop_back();
+	inEnd = readChunks.empty() ? bodyEnd : readChunks.back().end;
+}
+
+uint16_t Serializer::ChunkVersion() const {
+	if (unchunked || readChunks.empty()) {
+		return 1;
+	}
+	return readChunks.back().version;
+}
+
+void Serializer::Grow(size_t bytes) {
+	// Full states are all about the same size, this only happens the first few times
+	out->bytes.resize((std::max)(out->size + bytes, out->bytes.size() * 2));
+}
+
+// Offset from the start of the state
+size_t Serializer::WritePosition() {
+	if (out) {
+		return out->size;
+	}
+	return (size_t)(os->tellp() - osStart);
+}
+
+void Serializer::PadTo8() {
+	static const uint8_t zeros[8] = {};
+	size_t padding = (8 - (WritePosition() & 7)) & 7;
+	if (padding > 0) {
+		WriteBytes(zeros, padding);
+	}
+}
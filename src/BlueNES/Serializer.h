@@ -3,12 +3,52 @@
 #include <iostream>
 #include <vector>
 #include <array>
+#include <cstring>
+#include <stdexcept>
 
-struct HeaderState {
+// Save states are a header and then chunks, one for each part of the machine. Every chunk has a
+// tag, a version and its length, so a chunk nobody asks for is stepped over and the parts can be
+// read back in any order. Chunk data starts 8-byte aligned from the start of the state, a state
+// file mapped into memory is read where it is.
+// A chunk that grows keeps its old fields first and gets a higher version. Reading past the end of
+// a chunk throws, an older state is never read as garbage.
+// Version 1 states are the same data with no header or chunks, they still load.
+#define STATE_MAGIC 0x53454E42 // "BNES"
+#define STATE_VERSION 2
+#define STATE_VERSION_UNCHUNKED 1
+
+#define STATE_REGION_NTSC 0
 
+struct HeaderState {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t romHash; // Cartridge::romHash, 0 for a version 1 state
+	uint8_t region;
+	uint8_t reserved[7];
+};
 
+struct ChunkHeader {
+	uint32_t tag;
+	uint32_t size; // Bytes of data after the header, not counting padding to the next chunk
+	uint16_t version;
+	uint16_t reserved;
+	uint32_t reserved2;
 };
 
+// Four characters, so the chunks can be found by eye in a hex editor
+constexpr uint32_t ChunkTag(const char (&tag)[5]) {
+	return (uint32_t)(uint8_t)tag[0] | (uint32_t)(uint8_t)tag[1] << 8 | (uint32_t)(uint8_t)tag[2] << 16 | (uint32_t)(uint8_t)tag[3] << 24;
+}
+
+constexpr uint32_t CHUNK_CPU = ChunkTag("CPU ");
+constexpr uint32_t CHUNK_PPU = ChunkTag("PPU ");
+constexpr uint32_t CHUNK_RAM = ChunkTag("RAM ");
+constexpr uint32_t CHUNK_DMA = ChunkTag("DMA ");
+constexpr uint32_t CHUNK_APU = ChunkTag("APU ");
+constexpr uint32_t CHUNK_PRG_RAM = ChunkTag("PRAM");
+constexpr uint32_t CHUNK_CHR_RAM = ChunkTag("CRAM");
+constexpr uint32_t CHUNK_VRAM = ChunkTag("VRAM");
+
 struct CPUState {
 	uint8_t m_a;
 	uint8_t m_x;
@@ -99,18 +139,44 @@ struct SaveState {
 	uint16_t dmaCycles;
 };
 
+// Save state kept in memory, for rewind and run-ahead. Holds on to its memory between saves,
+// so once it has seen the biggest state, saving again is only the copies.
+struct StateBuffer {
+	std::vector<uint8_t> bytes; // Grows, never shrinks
+	size_t size = 0;            // How much of it is the state
+
+	const uint8_t* data() const { return bytes.data(); }
+};
+
+// Writes to either a stream or a StateBuffer, reads from memory: a StateBuffer, a file mapped into
+// memory, or a stream read in whole first.
 class Serializer {
 public:
+	void WriteHeader(uint64_t romHash, uint8_t region);
+	// Throws if it isn't a save state this version can load
+	HeaderState ReadHeader();
+
+	// Everything written between these goes in one chunk. Chunks can hold other chunks, but then
+	// only chunks, no loose data.
+	void BeginChunk(uint32_t tag, uint16_t version = 1);
+	void EndChunk();
+
+	// Finds the chunk among the ones at the level being read and reads from the start of it.
+	// False if there isn't one, then there's nothing to close.
+	bool OpenChunk(uint32_t tag);
+	// A state without this chunk can't be loaded
+	void RequireChunk(uint32_t tag);
+	void CloseChunk();
+	uint16_t ChunkVersion() const;
+
 	template<typename T>
 	void Write(const T& data) {
-		os->write(reinterpret_cast<const char*>(&data), sizeof(T));
+		WriteBytes(&data, sizeof(T));
 	}
 
 	template<typename T>
 	void Write(const T* data, size_t size) {
-		for (int i = 0; i < size; i++) {
-			os->write(reinterpret_cast<const char*>(&data[i]), sizeof(T));
-		}
+		WriteBytes(data, size * sizeof(T));
 	}
 
 	template<typename T>
@@ -119,11 +185,10 @@ public:
 			"Vector element type must be trivially copyable");
 
 		uint32_t size = static_cast<uint32_t>(v.size());
-		os->write(reinterpret_cast<const char*>(&size), sizeof(size));
+		WriteBytes(&size, sizeof(size));
 
 		if (size > 0) {
-			os->write(reinterpret_cast<const char*>(v.data()),
-				size * sizeof(T));
+			WriteBytes(v.data(), size * sizeof(T));
 		}
 	}
 
@@ -133,21 +198,18 @@ public:
 			"Vector element type must be trivially copyable");
 
 		if (size > 0) {
-			os->write(reinterpret_cast<const char*>(v.data()),
-				size * sizeof(T));
+			WriteBytes(v.data(), size * sizeof(T));
 		}
 	}
 
 	template<typename T>
 	void Read(T& data) {
-		is->read(reinterpret_cast<char*>(&data), sizeof(T));
+		ReadBytes(&data, sizeof(T));
 	}
 
 	template<typename T>
 	void Read(T* data, size_t size) {
-		for (int i = 0; i < size; i++) {
-			is->read(reinterpret_cast<char*>(&data[i]), sizeof(T));
-		}
+		ReadBytes(data, size * sizeof(T));
 	}
 
 	template<typename T>
@@ -156,13 +218,16 @@ public:
 			"Vector element type must be trivially copyable");
 
 		uint32_t size;
-		is->read(reinterpret_cast<char*>(&size), sizeof(size));
+		ReadBytes(&size, sizeof(size));
+		// The count is from the file, a damaged one mustn't get to allocate gigabytes
+		if (size > (size_t)(inEnd - in) / sizeof(T)) {
+			throw std::runtime_error("Save state is truncated");
+		}
 
 		v.resize(size);
 
 		if (size > 0) {
-			is->read(reinterpret_cast<char*>(v.data()),
-				size * sizeof(T));
+			ReadBytes(v.data(), size * sizeof(T));
 		}
 	}
 
@@ -172,15 +237,59 @@ public:
 			"Vector element type must be trivially copyable");
 
 		if (size > 0) {
-			is->read(reinterpret_cast<char*>(v.data()),
-				size * sizeof(T));
+			ReadBytes(v.data(), size * sizeof(T));
 		}
 	}
 
 	void StartSerialization(std::ostream& os);
+	void StartSerialization(StateBuffer& buffer);
 	void StartDeserialization(std::istream& is);
+	void StartDeserialization(const uint8_t* data, size_t size);
 
 private:
-	std::istream* is;
-	std::ostream* os;
+	struct ReadChunk {
+		const uint8_t* data;
+		const uint8_t* end;
+		uint16_t version;
+	};
+
+	std::ostream* os = nullptr;
+	std::streampos osStart;
+	// Memory backend, used instead of the stream when set
+	StateBuffer* out = nullptr;
+	std::vector<size_t> writeChunks; // Offsets of the headers of the chunks being written
+
+	const uint8_t* inStart = nullptr;
+	const uint8_t* in = nullptr;
+	const uint8_t* inEnd = nullptr;  // End of the chunk being read
+	const uint8_t* bodyStart = nullptr;
+	const uint8_t* bodyEnd = nullptr;
+	bool unchunked = false;
+	std::vector<ReadChunk> readChunks; // Innermost last
+	std::vector<uint8_t> streamData;   // A stream being read, read in whole
+
+	void WriteBytes(const void* data, size_t bytes) {
+		if (out) {
+			if (out->size + bytes > out->bytes.size()) {
+				Grow(bytes);
+			}
+			memcpy(out->bytes.data() + out->size, data, bytes);
+			out->size += bytes;
+		}
+		else {
+			os->write(reinterpret_cast<const char*>(data), bytes);
+		}
+	}
+
+	void ReadBytes(void* data, size_t bytes) {
+		if (bytes > (size_t)(inEnd - in)) {
+			throw std::runtime_error("Save state is truncated");
+		}
+		memcpy(data, in, bytes);
+		in += bytes;
+	}
+
+	void Grow(size_t bytes);
+	size_t WritePosition();
+	void PadTo8();
 };
\ No newline at end of file
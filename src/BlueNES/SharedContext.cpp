@@ -1,12 +1,60 @@
 #include "SharedContext.h"
 #include "DebuggerContext.h"
+#include <chrono>
 
 SharedContext::SharedContext() {
     debugger_context = new DebuggerContext();
-    buffer_1.resize(WIDTH * HEIGHT, 0xFF000000); // Fill Black
-    buffer_2.resize(WIDTH * HEIGHT, 0xFF000000);
+    for (auto& buffer : buffers) {
+        buffer.resize(WIDTH * HEIGHT, 0xFF000000); // Fill Black
+    }
+}
 
-    // Assign initial pointers
-    p_front_buffer = buffer_1.data();
-    p_back_buffer = buffer_2.data();
-}
\ No newline at end of file
+// Run-ahead makes and drops one of these for its second Nes every time a game is loaded
+SharedContext::~SharedContext() {
+    delete debugger_context;
+}
+
+void SharedContext::SwapBuffers() {
+    FrameInfo& info = frameInfo[backIndex];
+    info.sequence = nextSequence++;
+    info.timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    // Whatever was the newest frame is ours to draw over now. If the UI never took it, it's dropped.
+    backIndex = latest.exchange(backIndex | FRESH) & 3;
+
+    if (ui_waiting.load()) {
+        // Taking the lock makes sure the UI is either asleep already or will see the frame before it sleeps
+        { std::lock_guard<std::mutex> lock(video_mutex); }
+        cv_frame_ready.notify_one();
+    }
+}
+
+// Swaps the newest frame in for the UI's, if there is one it hasn't had yet
+bool SharedContext::TakeNewFrame() {
+    if ((latest.load() & FRESH) == 0) {
+        return false;
+    }
+    frontIndex = latest.exchange(frontIndex) & 3;
+    // Everything published since the last one we took was never shown, including whatever came
+    // before the first one (lastSequence stays 0 until then, sequences start at 1)
+    uint64_t sequence = frameInfo[frontIndex].sequence;
+    droppedFrames += sequence - lastSequence - 1;
+    lastSequence = sequence;
+    return true;
+}
+
+const uint32_t* SharedContext::WaitForNewFrame(int timeout_ms) {
+    if (!TakeNewFrame()) {
+        ui_waiting.store(true);
+        {
+            std::unique_lock<std::mutex> lock(video_mutex);
+            cv_frame_ready.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                [this] { return (latest.load() & FRESH) != 0; });
+        }
+        ui_waiting.store(false);
+        if (!TakeNewFrame()) {
+            return nullptr; // Timed out (Core is lagging or paused)
+        }
+    }
+    return buffers[frontIndex].data();
+}
@@ -3,6 +3,7 @@
 #include <condition_variable>
 #include <cstdint>
 #include <vector>
+#include <atomic>
 #include "CommandQueue.h"
 
 #define WIDTH 256
@@ -13,20 +14,38 @@ class DebuggerContext;
 // Synchronization context shared between the Core and UI threads.
 // Prevents multi-threading issues when accessing shared resources like video buffer and debugger state.
 class SharedContext {
+public:
+    // Stamped on every frame the core publishes. A gap in sequence means frames were dropped
+    // (the UI was too slow to see them), the same sequence twice means the UI showed it twice.
+    struct FrameInfo {
+        uint64_t sequence = 0;   // 1 for the first frame published
+        int64_t timestampNs = 0; // steady_clock, when it was published
+    };
+
 private:
+    // Triple buffer. The core draws into one, the UI shows another, and the third holds the newest
+    // frame neither is using. Publishing swaps the core's buffer with that one and taking a frame
+    // swaps the UI's, each a single atomic exchange, so neither ever waits on the other.
+    std::vector<uint32_t> buffers[3];
+    FrameInfo frameInfo[3];
+    // Index of the buffer with the newest frame, plus FRESH if the UI hasn't taken it yet
+    static constexpr uint32_t FRESH = 4;
+    std::atomic<uint32_t> latest{ 2 };
+    uint32_t backIndex = 0;  // Core's
+    uint32_t frontIndex = 1; // UI's
+    uint64_t nextSequence = 1;
+
+    // Only for putting the UI to sleep while it waits. The core takes it only when the UI is asleep in there.
     std::mutex video_mutex;
-    std::condition_variable cv_frame_ready; // The signal object
+    std::condition_variable cv_frame_ready;
+    std::atomic<bool> ui_waiting{ false };
 
-    // We allocate the memory once.
-    std::vector<uint32_t> buffer_1;
-    std::vector<uint32_t> buffer_2;
+    // UI side frame telemetry
+    uint64_t lastSequence = 0; // Of the last frame taken, 0 before the first
+    uint64_t droppedFrames = 0;
 
-    // Pointers that will swap targets
-    uint32_t* p_front_buffer = nullptr; // UI Reads this
-    uint32_t* p_back_buffer = nullptr;  // Core Writes this
+    bool TakeNewFrame();
 
-    // Flag to prevent spurious wakeups
-    bool has_new_frame = false;
 public:
     struct CpuState {
         uint16_t pc;
@@ -42,54 +61,50 @@ public:
     std::atomic<uint16_t> current_fps{ 0 };
     std::atomic<uint8_t> mirrorMode;
     std::atomic<bool> coreRunning{ false };
+    // Rewind telemetry, averages over the last second, updated with current_fps
+    std::atomic<uint32_t> rewindStates{ 0 };
+    std::atomic<uint32_t> rewindBytesPerFrame{ 0 };
+    std::atomic<uint32_t> rewindCaptureUs{ 0 };
+    // Run-ahead settings for the loaded game, and what it costs a frame
+    std::atomic<uint8_t> runAheadFrames{ 0 };
+    std::atomic<bool> runAheadSecondInstance{ false };
+    std::atomic<uint32_t> runAheadOverheadUs{ 0 };
+    // The last save state: core thread time taking the snapshot, time until it was on disk, and its size there
+    std::atomic<uint32_t> saveStateSnapshotUs{ 0 };
+    std::atomic<uint32_t> saveStateLatencyUs{ 0 };
+    std::atomic<uint32_t> saveStateBytes{ 0 };
+    std::atomic<bool> saveStateFailed{ false };
 
     SharedContext();
+    ~SharedContext();
 
     // --- CORE calls this ---
     // Returns a pointer to the memory where the Core should draw the NEXT frame.
-    // We do not lock here to allow the core to write freely.
+    // Nobody else touches it until it is published.
     uint32_t* GetBackBuffer() {
-        return p_back_buffer;
+        return buffers[backIndex].data();
     }
 
     // --- CORE calls this ---
-    // Signals that the back buffer is full and ready to be shown.
-    void SwapBuffers() {
-        {
-            std::lock_guard<std::mutex> lock(video_mutex);
-            std::swap(p_front_buffer, p_back_buffer);
-            has_new_frame = true;
-        } // Mutex releases here
-        // Wake up the UI thread immediately
-        cv_frame_ready.notify_one();
-    }
+    // Publishes the back buffer as the newest frame and hands the core a free one to draw the next in.
+    void SwapBuffers();
 
     // --- UI calls this ---
-    // Returns nullptr if timeout occurs (no new frame)
-    const uint32_t* WaitForNewFrame(int timeout_ms) {
-        std::unique_lock<std::mutex> lock(video_mutex);
-
-        // This puts the thread to SLEEP. It releases the mutex while sleeping.
-        // It wakes up ONLY if:
-        // 1. notify_one() is called AND has_new_frame is true
-        // 2. timeout_ms passes
-        bool received = cv_frame_ready.wait_for(lock, std::chrono::milliseconds(timeout_ms),
-            [this] { return has_new_frame; });
-
-        if (received) {
-            has_new_frame = false; // Reset for next time
-            return p_front_buffer;
-        }
-
-        return nullptr; // Timed out (Core is lagging or paused)
-    }
+    // Returns the newest frame the core has published since the last call, waiting up to
+    // timeout_ms for one. Returns nullptr if timeout occurs (no new frame).
+    const uint32_t* WaitForNewFrame(int timeout_ms);
 
     // --- UI calls this ---
-    // Returns the most recent completed frame. 
-    // We return a const pointer because UI should only read.
-    const uint32_t* GetFrontBuffer() {
-        std::lock_guard<std::mutex> lock(video_mutex);
-        return p_front_buffer;
+    // Returns the frame the UI has now. Stays valid until the UI takes a new one.
+    const uint32_t* GetFrontBuffer() const {
+        return buffers[frontIndex].data();
+    }
+    const FrameInfo& GetFrontFrameInfo() const {
+        return frameInfo[frontIndex];
+    }
+    // Frames published that the UI never got to see
+    uint64_t GetDroppedFrames() const {
+        return droppedFrames;
     }
 
 	CommandQueue command_queue;
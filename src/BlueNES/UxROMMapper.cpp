@@ -63,10 +63,14 @@ void UxROMMapper::RecomputeChrMappings() {
 
 void UxROMMapper::Serialize(Serializer& serializer) {
 	MapperBase::Serialize(serializer);
+	serializer.BeginChunk(ChunkTag("UxRO"));
 	serializer.Write(prg_bank_select);
+	serializer.EndChunk();
 }
 
 void UxROMMapper::Deserialize(Serializer& serializer) {
 	MapperBase::Deserialize(serializer);
+	serializer.RequireChunk(ChunkTag("UxRO"));
 	serializer.Read(prg_bank_select);
+	serializer.CloseChunk();
 }
\ No newline at end of file